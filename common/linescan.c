@@ -0,0 +1,297 @@
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include "linescan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LINESCAN_X86 1
+#endif
+
+#define LF_BYTES 0x0a0a0a0a0a0a0a0aULL
+#define LOW_BITS 0x7f7f7f7f7f7f7f7fULL
+#define ONE_BYTES 0x0101010101010101ULL
+
+struct linescan_ops {
+	const char *name;
+	size_t (*count)(const char *data, size_t size);
+	uint64_t (*mask)(const char *data);
+};
+
+/*--- portable 64 bit variant ---*/
+
+static inline uint64_t _hits8(const char *data)
+{
+	uint64_t word;
+
+	/* sets the top bit of every byte which is a line feed, without false positives */
+	memcpy(&word, data, sizeof (word));
+	word ^= LF_BYTES;
+
+	return ~(((word & LOW_BITS) + LOW_BITS) | word | LOW_BITS);
+}
+
+static inline uint64_t _popcount64(uint64_t value)
+{
+	value -= (value >> 1) & 0x5555555555555555ULL;
+	value = (value & 0x3333333333333333ULL) + ((value >> 2) & 0x3333333333333333ULL);
+	value = (value + (value >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+
+	return (value * ONE_BYTES) >> 56;
+}
+
+static inline size_t _min_blocks(size_t blocks)
+{
+	/* byte counters can take 255 hits before they have to be summed up */
+	return (blocks > 255) ? 255 : blocks;
+}
+
+static size_t count_tail(const char *data, size_t size)
+{
+	size_t count = 0;
+
+	for (size_t i = 0; i < size; ++i)
+		count += (data[i] == '\n');
+
+	return count;
+}
+
+static uint64_t mask_tail(const char *data, size_t size)
+{
+	uint64_t mask = 0;
+
+	for (size_t i = 0; i < size; ++i)
+		mask |= (uint64_t)(data[i] == '\n') << i;
+
+	return mask;
+}
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+static size_t count_scalar(const char *data, size_t size)
+{
+	size_t count = 0;
+
+	for (; size >= 8; data += 8, size -= 8)
+		count += ((_hits8(data) >> 7) * ONE_BYTES) >> 56;
+
+	return count + count_tail(data, size);
+}
+
+static uint64_t mask_scalar(const char *data)
+{
+	uint64_t mask = 0;
+
+	for (unsigned i = 0; i < 64; i += 8)
+		mask |= (((_hits8(data + i) >> 7) * 0x0102040810204080ULL) >> 56) << i;
+
+	return mask;
+}
+#else
+static size_t count_scalar(const char *data, size_t size)
+{
+	return count_tail(data, size);
+}
+
+static uint64_t mask_scalar(const char *data)
+{
+	return mask_tail(data, 64);
+}
+#endif
+
+/*--- sse2 and avx2 variants ---*/
+
+#ifdef LINESCAN_X86
+__attribute__((target("sse2")))
+static size_t count_sse2(const char *data, size_t size)
+{
+	const __m128i lf = _mm_set1_epi8('\n');
+	size_t count = 0;
+
+	while (size >= 16) {
+		size_t blocks = _min_blocks(size / 16);
+		__m128i acc = _mm_setzero_si128();
+
+		size -= blocks * 16;
+		for (; blocks; --blocks, data += 16)
+			acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)data),
+								 lf));
+		acc = _mm_sad_epu8(acc, _mm_setzero_si128());
+		count += _mm_extract_epi16(acc, 0) + _mm_extract_epi16(acc, 4);
+	}
+
+	return count + count_tail(data, size);
+}
+
+__attribute__((target("sse2")))
+static uint64_t mask_sse2(const char *data)
+{
+	const __m128i lf = _mm_set1_epi8('\n');
+	uint64_t mask = 0;
+
+	for (unsigned i = 0; i < 64; i += 16)
+		mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(
+			_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(data + i)), lf)) << i;
+
+	return mask;
+}
+
+__attribute__((target("avx2")))
+static size_t count_avx2(const char *data, size_t size)
+{
+	const __m256i lf = _mm256_set1_epi8('\n');
+	uint64_t sums[4];
+	size_t count = 0;
+
+	while (size >= 32) {
+		size_t blocks = _min_blocks(size / 32);
+		__m256i acc = _mm256_setzero_si256();
+
+		size -= blocks * 32;
+		for (; blocks; --blocks, data += 32)
+			acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(
+				_mm256_loadu_si256((const __m256i *)data), lf));
+		acc = _mm256_sad_epu8(acc, _mm256_setzero_si256());
+		_mm256_storeu_si256((__m256i *)sums, acc);
+		count += sums[0] + sums[1] + sums[2] + sums[3];
+	}
+
+	return count + count_tail(data, size);
+}
+
+__attribute__((target("avx2")))
+static uint64_t mask_avx2(const char *data)
+{
+	const __m256i lf = _mm256_set1_epi8('\n');
+	const uint32_t lo = _mm256_movemask_epi8(
+		_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)data), lf));
+	const uint32_t hi = _mm256_movemask_epi8(
+		_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(data + 32)), lf));
+
+	return ((uint64_t)hi << 32) | lo;
+}
+#endif
+
+/*--- dispatching ---*/
+
+static const struct linescan_ops linescan_variants[] = {
+#ifdef LINESCAN_X86
+	{ "avx2", count_avx2, mask_avx2 },
+	{ "sse2", count_sse2, mask_sse2 },
+#endif
+	{ "scalar", count_scalar, mask_scalar },
+};
+
+static const struct linescan_ops *linescan_ops =
+	&linescan_variants[sizeof (linescan_variants) / sizeof (linescan_variants[0]) - 1];
+
+static int _supported(const struct linescan_ops *ops)
+{
+#ifdef LINESCAN_X86
+	__builtin_cpu_init();
+	if (!strcmp(ops->name, "avx2"))
+		return __builtin_cpu_supports("avx2");
+	if (!strcmp(ops->name, "sse2"))
+		return __builtin_cpu_supports("sse2");
+#endif
+	return !strcmp(ops->name, "scalar");
+}
+
+__attribute__((constructor))
+static void linescan_init(void)
+{
+	linescan_select(NULL);
+}
+
+ssize_t linescan_select(const char *name)
+{
+	for (size_t i = 0; i < sizeof (linescan_variants) / sizeof (linescan_variants[0]); ++i) {
+		const struct linescan_ops *ops = &linescan_variants[i];
+
+		if ((!name || !strcmp(name, ops->name)) && _supported(ops)) {
+			linescan_ops = ops;
+			return 0;
+		}
+	}
+
+	return -EINVAL;
+}
+
+const char *linescan_name(void)
+{
+	return linescan_ops->name;
+}
+
+/*--- scanning ---*/
+
+ssize_t linescan_count(const char *data, size_t size)
+{
+	if (!data && size)
+		return -EFAULT;
+
+	return linescan_ops->count(data, size);
+}
+
+ssize_t linescan_nth(const char *data, size_t size, size_t nth)
+{
+	if (!data && size)
+		return -EFAULT;
+	if (!nth)
+		return -EINVAL;
+
+	uint64_t (*mask64)(const char *) = linescan_ops->mask;
+
+	for (size_t offset = 0; offset < size; offset += 64) {
+		uint64_t mask = ((size - offset) >= 64) ? mask64(data + offset)
+							: mask_tail(data + offset, size - offset);
+		const size_t hits = _popcount64(mask);
+
+		if (hits < nth) {
+			nth -= hits;
+			continue;
+		}
+
+		while (--nth)
+			mask &= mask - 1;
+
+		return offset + __builtin_ctzll(mask);
+	}
+
+	return -ENOENT;
+}
+
+ssize_t linescan_starts(const char *data, size_t size, size_t *starts, size_t max)
+{
+	if ((!data && size) || (!starts && max))
+		return -EFAULT;
+
+	uint64_t (*mask64)(const char *) = linescan_ops->mask;
+	size_t count = 0;
+
+	for (size_t offset = 0; (offset < size) && (count < max); offset += 64) {
+		uint64_t mask = ((size - offset) >= 64) ? mask64(data + offset)
+							: mask_tail(data + offset, size - offset);
+
+		for (; mask && (count < max); mask &= mask - 1)
+			starts[count++] = offset + __builtin_ctzll(mask) + 1;
+	}
+
+	return count;
+}
@@ -0,0 +1,43 @@
+#pragma once
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Line feed scanner shared by both versions. The scan loops exist as AVX2, SSE2 and portable
+ * 64 bit variants, the best one supported by the cpu is selected once at startup.
+ *
+ * linescan_count  - number of line feeds in data
+ * linescan_nth    - offset of the nth (1 based) line feed in data
+ * linescan_starts - offsets of the lines following each line feed, at most max entries
+ */
+ssize_t linescan_count(const char *data, size_t size);
+ssize_t linescan_nth(const char *data, size_t size, size_t nth);
+ssize_t linescan_starts(const char *data, size_t size, size_t *starts, size_t max);
+ssize_t linescan_select(const char *name);
+const char *linescan_name(void);
+
+#ifdef __cplusplus
+}
+#endif
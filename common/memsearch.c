@@ -0,0 +1,228 @@
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include "memsearch.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MEMSEARCH_X86 1
+#endif
+
+struct memsearch_ops {
+	const char *name;
+	ssize_t (*find)(const char *data, size_t size, const char *needle, size_t length);
+};
+
+/*--- portable variant ---*/
+
+#define LOW_BITS 0x7f7f7f7f7f7f7f7fULL
+#define ONE_BYTES 0x0101010101010101ULL
+
+static ssize_t find_tail(const char *data, size_t size, const char *needle, size_t length)
+{
+	const char *end = data + size - length + 1;
+	const char *pos = data;
+
+	while ((pos < end) && (pos = memchr(pos, needle[0], end - pos))) {
+		if ((pos[length - 1] == needle[length - 1]) && !memcmp(pos + 1, needle + 1, length - 2))
+			return pos - data;
+		++pos;
+	}
+
+	return -ENOENT;
+}
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+static inline uint64_t _equal8(const char *data, const uint64_t pattern)
+{
+	uint64_t word;
+
+	/* sets the top bit of every byte equal to the pattern byte, without false positives */
+	memcpy(&word, data, sizeof (word));
+	word ^= pattern;
+
+	return ~(((word & LOW_BITS) + LOW_BITS) | word | LOW_BITS);
+}
+
+static ssize_t find_scalar(const char *data, size_t size, const char *needle, size_t length)
+{
+	const uint64_t first = (uint8_t)needle[0] * ONE_BYTES;
+	const uint64_t last = (uint8_t)needle[length - 1] * ONE_BYTES;
+	size_t i = 0;
+
+	for (; (i + length - 1 + 8) <= size; i += 8) {
+		uint64_t mask = _equal8(data + i, first) & _equal8(data + i + length - 1, last);
+
+		for (; mask; mask &= mask - 1) {
+			const size_t pos = i + (__builtin_ctzll(mask) >> 3);
+
+			if (!memcmp(data + pos + 1, needle + 1, length - 2))
+				return pos;
+		}
+	}
+
+	if (i + length > size)
+		return -ENOENT;
+
+	const ssize_t pos = find_tail(data + i, size - i, needle, length);
+
+	return (pos < 0) ? pos : (ssize_t)(i + pos);
+}
+#else
+static ssize_t find_scalar(const char *data, size_t size, const char *needle, size_t length)
+{
+	return find_tail(data, size, needle, length);
+}
+#endif
+
+/*--- sse2 and avx2 variants ---*/
+
+#ifdef MEMSEARCH_X86
+__attribute__((target("sse2")))
+static ssize_t find_sse2(const char *data, size_t size, const char *needle, size_t length)
+{
+	const __m128i first = _mm_set1_epi8(needle[0]);
+	const __m128i last = _mm_set1_epi8(needle[length - 1]);
+	size_t i = 0;
+
+	/* both loads cover 16 candidate positions, the second one ends at the last needle byte */
+	for (; (i + length - 1 + 16) <= size; i += 16) {
+		const __m128i head = _mm_loadu_si128((const __m128i *)(data + i));
+		const __m128i tail = _mm_loadu_si128((const __m128i *)(data + i + length - 1));
+		uint32_t mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(head, first),
+								  _mm_cmpeq_epi8(tail, last)));
+
+		for (; mask; mask &= mask - 1) {
+			const size_t pos = i + __builtin_ctz(mask);
+
+			if (!memcmp(data + pos + 1, needle + 1, length - 2))
+				return pos;
+		}
+	}
+
+	if (i + length > size)
+		return -ENOENT;
+
+	const ssize_t pos = find_tail(data + i, size - i, needle, length);
+
+	return (pos < 0) ? pos : (ssize_t)(i + pos);
+}
+
+__attribute__((target("avx2")))
+static ssize_t find_avx2(const char *data, size_t size, const char *needle, size_t length)
+{
+	const __m256i first = _mm256_set1_epi8(needle[0]);
+	const __m256i last = _mm256_set1_epi8(needle[length - 1]);
+	size_t i = 0;
+
+	for (; (i + length - 1 + 32) <= size; i += 32) {
+		const __m256i head = _mm256_loadu_si256((const __m256i *)(data + i));
+		const __m256i tail = _mm256_loadu_si256((const __m256i *)(data + i + length - 1));
+		uint32_t mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(head, first),
+								       _mm256_cmpeq_epi8(tail, last)));
+
+		for (; mask; mask &= mask - 1) {
+			const size_t pos = i + __builtin_ctz(mask);
+
+			if (!memcmp(data + pos + 1, needle + 1, length - 2))
+				return pos;
+		}
+	}
+
+	if (i + length > size)
+		return -ENOENT;
+
+	const ssize_t pos = find_tail(data + i, size - i, needle, length);
+
+	return (pos < 0) ? pos : (ssize_t)(i + pos);
+}
+#endif
+
+/*--- dispatching ---*/
+
+static const struct memsearch_ops memsearch_variants[] = {
+#ifdef MEMSEARCH_X86
+	{ "avx2", find_avx2 },
+	{ "sse2", find_sse2 },
+#endif
+	{ "scalar", find_scalar },
+};
+
+static const struct memsearch_ops *memsearch_ops =
+	&memsearch_variants[sizeof (memsearch_variants) / sizeof (memsearch_variants[0]) - 1];
+
+static int _supported(const struct memsearch_ops *ops)
+{
+#ifdef MEMSEARCH_X86
+	__builtin_cpu_init();
+	if (!strcmp(ops->name, "avx2"))
+		return __builtin_cpu_supports("avx2");
+	if (!strcmp(ops->name, "sse2"))
+		return __builtin_cpu_supports("sse2");
+#endif
+	return !strcmp(ops->name, "scalar");
+}
+
+__attribute__((constructor))
+static void memsearch_init(void)
+{
+	memsearch_select(NULL);
+}
+
+ssize_t memsearch_select(const char *name)
+{
+	for (size_t i = 0; i < sizeof (memsearch_variants) / sizeof (memsearch_variants[0]); ++i) {
+		const struct memsearch_ops *ops = &memsearch_variants[i];
+
+		if ((!name || !strcmp(name, ops->name)) && _supported(ops)) {
+			memsearch_ops = ops;
+			return 0;
+		}
+	}
+
+	return -EINVAL;
+}
+
+const char *memsearch_name(void)
+{
+	return memsearch_ops->name;
+}
+
+/*--- searching ---*/
+
+ssize_t memsearch_find(const char *data, size_t size, const char *needle, size_t length)
+{
+	if ((!data && size) || (!needle && length))
+		return -EFAULT;
+	if (!length)
+		return -EINVAL;
+	if (length > size)
+		return -ENOENT;
+
+	/* a single byte is what memchr() is made for */
+	if (length == 1) {
+		const char *pos = memchr(data, needle[0], size);
+
+		return pos ? (pos - data) : -ENOENT;
+	}
+
+	return memsearch_ops->find(data, size, needle, length);
+}
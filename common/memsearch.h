@@ -0,0 +1,41 @@
+#pragma once
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Substring search shared by both versions. Candidates are found by comparing the first and the
+ * last byte of the needle at many positions at once (AVX2, SSE2 or memchr() as portable variant)
+ * and only those are compared completely. The best variant supported by the cpu is selected once
+ * at startup.
+ *
+ * memsearch_find - offset of the first occurrence of needle in data, -ENOENT if there is none
+ */
+ssize_t memsearch_find(const char *data, size_t size, const char *needle, size_t length);
+ssize_t memsearch_select(const char *name);
+const char *memsearch_name(void);
+
+#ifdef __cplusplus
+}
+#endif
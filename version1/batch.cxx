@@ -0,0 +1,237 @@
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <utility>
+#include <vector>
+#include "batch.hxx"
+
+const std::pair<const char *, int32_t> key_names[] = {
+    {"up", key_up},
+    {"down", key_down},
+    {"left", key_left},
+    {"right", key_right},
+    {"home", key_home},
+    {"end", key_end},
+    {"pageup", key_page_up},
+    {"pagedown", key_page_down},
+    {"filestart", key_file_start},
+    {"fileend", key_file_end},
+    {"enter", '\n'},
+    {"backspace", key_backspace},
+    {"delete", key_delete},
+    {"undo", key_undo},
+    {"redo", key_redo},
+    {"nextbuffer", key_next_buffer},
+    {"previousbuffer", key_previous_buffer},
+    {"wrap", key_wrap},
+};
+
+static bool typeKeys(const std::string &text, std::vector<int32_t> &keys)
+{
+    // typed text is handed over like a paste, so it becomes a single insert
+    keys.assign(1, key_paste_begin);
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        if (text[i] != '\\')
+            keys.push_back(static_cast<unsigned char>(text[i]));
+        else if (++i >= text.size())
+            return false;
+        else if (text[i] == 'n')
+            keys.push_back('\n');
+        else if (text[i] == '\\')
+            keys.push_back('\\');
+        else
+            return false;
+    }
+    keys.push_back(key_paste_end);
+
+    return true;
+}
+
+static bool pressKeys(const std::string &arguments, std::vector<int32_t> &keys)
+{
+    std::istringstream stream(arguments);
+    std::string name;
+    std::string repeat;
+    size_t count = 1;
+
+    stream >> name >> repeat;
+    if (!repeat.empty())
+    {
+        char *end;
+
+        count = std::strtoull(repeat.c_str(), &end, 10);
+        if (*end || !count)
+            return false;
+    }
+
+    for (const auto &[key_name, key] : key_names)
+    {
+        if (name == key_name)
+        {
+            keys.assign(count, key);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool printBuffer(const TextBuffer &buffer)
+{
+    const bool result = buffer.forEachSpan([](const char *data, size_t length) {
+        return std::fwrite(data, 1, length, stdout) == length;
+    });
+
+    return result && (std::fputc('\n', stdout) != EOF) && !std::fflush(stdout);
+}
+
+static bool printCount(const TextBuffer &buffer, const std::string &arguments)
+{
+    std::vector<int32_t> keys;
+    std::string needle;
+    SearchJob search;
+
+    if (!typeKeys(arguments, keys) || (keys.size() < 3))
+        return false;
+
+    // the typed keys without the paste markers are the needle
+    for (size_t i = 1; (i + 1) < keys.size(); ++i)
+        needle += static_cast<char>(keys[i]);
+    search.start(buffer, needle, 0);
+    search.wait();
+
+    return (std::printf("%zu\n", search.count()) > 0) && !std::fflush(stdout);
+}
+
+static bool runCommand(Workspace &workspace, const std::string &command,
+                       const std::string &arguments)
+{
+    Editor &editor = workspace.editor();
+    std::vector<int32_t> keys;
+
+    if (command == "type")
+    {
+        if (!typeKeys(arguments, keys))
+            return false;
+    }
+    else if (command == "key")
+    {
+        if (!pressKeys(arguments, keys))
+            return false;
+    }
+    else if (command == "find")
+    {
+        if (!typeKeys(arguments, keys))
+            return false;
+        keys.insert(keys.begin(), key_find);
+        keys.push_back('\n');
+    }
+    else if (command == "regex")
+    {
+        if (!typeKeys(arguments, keys))
+            return false;
+        keys.insert(keys.begin(), key_find_regex);
+        keys.push_back('\n');
+    }
+    else if (command == "goto")
+    {
+        if (arguments.empty() || (arguments.find_first_not_of("0123456789") != std::string::npos))
+            return false;
+        keys.assign(1, key_goto);
+        keys.insert(keys.end(), arguments.begin(), arguments.end());
+        keys.push_back('\n');
+    }
+    else if (command == "findnext")
+        keys = {key_find, key_find, '\n'};
+    else if (command == "replace")
+    {
+        if (!typeKeys(arguments, keys))
+            return false;
+        keys.insert(keys.begin(), key_replace);
+        keys.push_back('\n');
+    }
+    else if (command == "count")
+        return printCount(editor.buffer(), arguments);
+    else if (command == "save")
+        return editor.saveFile() && editor.finishJob(true);
+    else if (command == "reload")
+        return editor.reloadFile() && editor.finishJob(true);
+    else if (command == "open")
+    {
+        if (arguments.empty())
+            return false;
+        workspace.open(arguments);
+        return true;
+    }
+    else if (command == "print")
+        return printBuffer(editor.buffer());
+    else if (command == "quit")
+        keys.assign(1, key_quit);
+    else
+        return false;
+
+    // nothing is drawn, so the changed lines are of no interest
+    workspace.processKeys(keys);
+    if (workspace.running())
+        workspace.editor().clearDirty();
+
+    return true;
+}
+
+int32_t runBatch(Workspace &workspace, const std::string &script)
+{
+    std::ifstream file;
+    std::istream &stream = (script == "-") ? std::cin : file;
+    std::string line;
+    size_t number = 0;
+
+    if (script != "-")
+    {
+        file.open(script);
+        if (!file)
+        {
+            std::fprintf(stderr, "cannot open script %s\n", script.c_str());
+            return 1;
+        }
+    }
+
+    while (workspace.running() && std::getline(stream, line))
+    {
+        const size_t split = line.find(' ');
+        const std::string command = line.substr(0, split);
+        const std::string arguments = (split == std::string::npos) ? "" : line.substr(split + 1);
+
+        ++number;
+        if (command.empty() || (command[0] == '#'))
+            continue;
+
+        if (!runCommand(workspace, command, arguments))
+        {
+            std::fprintf(stderr, "%s:%zu: '%s' failed\n", script.c_str(), number, line.c_str());
+            return 1;
+        }
+    }
+
+    return 0;
+}
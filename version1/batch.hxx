@@ -0,0 +1,49 @@
+#pragma once
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <string>
+#include "workspace.hxx"
+
+// batch mode has no screen, the view is as large as a terminal and scrolls sideways like one
+const int32_t batch_rows = 22;
+const int32_t batch_cols = 80;
+
+// Applies a script to the workspace without a terminal, "-" reads the script from stdin. Commands go
+// to the buffer shown. Every line of the script is one command, empty lines and lines starting with
+// '#' are skipped:
+//   type <text>       inserts text at the cursor, "\n" is a line break and "\\" a backslash
+//   key <name> [n]    presses a key n times: up, down, left, right, home, end, pageup, pagedown,
+//                     filestart, fileend, enter, backspace, delete, undo, redo, nextbuffer,
+//                     previousbuffer, wrap
+//   goto <line>       moves the cursor to the start of a line, counted from 0 like the header does
+//   find <text>       moves the cursor to the next occurrence of text, same escapes as type
+//   regex <pattern>   moves the cursor to the next match of pattern, same escapes as type, so a
+//                     backslash of the pattern is written as "\\"
+//   findnext          moves the cursor to the next occurrence of the last text found
+//   replace <text>    replaces all occurrences or matches of the last find or regex by text,
+//                     same escapes as type
+//   count <text>      writes the number of occurrences of text to stdout, same escapes as type
+//   save              saves the file and waits until it is written
+//   reload            reloads the file and waits until it is loaded
+//   open <file>       opens file in a new buffer and shows it
+//   print             writes the whole buffer to stdout
+//   quit              closes the buffer, the script stops once no buffer is left
+// Returns 0 when every command succeeded, otherwise the script stops at the failing command.
+int32_t runBatch(Workspace &workspace, const std::string &script);
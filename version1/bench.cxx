@@ -0,0 +1,381 @@
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <unistd.h>
+#include "fileio.hxx"
+#include "indexer.hxx"
+#include "regex.hxx"
+#include "search.hxx"
+#include "textbuffer.hxx"
+
+// Headless benchmark of the buffer operations the editor does: loading, editing at random places
+// the way typing, ENTER and BACKSPACE do, fetching screen rows the way drawGUI does, searching and
+// saving.
+// Every phase reports operations per second and latency percentiles, the run ends with peak RSS.
+
+using Clock = std::chrono::steady_clock;
+
+// screen size used for the scrolling phase
+const size_t rows = 50;
+const size_t cols = 120;
+
+class Phase {
+public:
+    //--- public constructors ---
+    Phase(const char *name)
+    : _samples(), _name(name), _total(0)
+    {
+    }
+
+    Phase(const Phase &rhs) = delete;
+    Phase(Phase &&rhs) = delete;
+    ~Phase() noexcept = default;
+
+    //--- public operators ---
+    Phase &operator=(const Phase &rhs) = delete;
+    Phase &operator=(Phase &&rhs) = delete;
+
+    //--- public methods ---
+    template <typename Func>
+    void run(const size_t count, Func &&func)
+    {
+        _samples.reserve(_samples.size() + count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const Clock::time_point start = Clock::now();
+
+            func();
+
+            const uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         Clock::now() - start).count();
+
+            _samples.push_back(elapsed);
+            _total += elapsed;
+        }
+    }
+
+    // bytes are only given for phases which move file content, they add the throughput column
+    void report(const size_t bytes = 0)
+    {
+        const double seconds = std::max(_total / 1e9, 1e-9);
+        char throughput[32] = "-";
+
+        std::sort(_samples.begin(), _samples.end());
+        if (bytes)
+            std::snprintf(throughput, sizeof (throughput), "%.1f", bytes / 1e6 / seconds);
+
+        std::printf("%-16s %9zu %12.0f %10.2f %10.2f %10.2f %10.2f %10s\n", _name,
+                    _samples.size(), _samples.size() / seconds, percentile(0.5), percentile(0.9),
+                    percentile(0.99), percentile(1.0), throughput);
+    }
+
+private:
+    //--- private methods ---
+    double percentile(const double fraction) const
+    {
+        if (_samples.empty())
+            return 0;
+
+        const size_t index = std::min<size_t>(fraction * _samples.size(), _samples.size() - 1);
+
+        return _samples[index] / 1e3;
+    }
+
+    //--- private properties ---
+    std::vector<uint64_t> _samples;
+    const char *_name;
+    uint64_t _total;
+};
+
+static std::string makeContent(const size_t lines, std::mt19937_64 &rng)
+{
+    std::string content;
+
+    // mostly short source code like lines with some long ones in between
+    for (size_t i = 0; i < lines; ++i)
+    {
+        const size_t length = (rng() % 16) ? (rng() % 80) : (rng() % 1000);
+
+        content += std::to_string(i) + ":";
+        for (size_t j = 0; j < length; ++j)
+            content += static_cast<char>('a' + (j % 26));
+        content += '\n';
+    }
+
+    return content;
+}
+
+static void usage(const char *name)
+{
+    std::printf("usage: %s [-l lines] [-n operations] [-f file]\n"
+                "  -l  lines of the generated test file (default 1000000)\n"
+                "  -n  operations per editing phase (default 100000)\n"
+                "  -f  use this file instead of a generated one, it is not modified\n", name);
+}
+
+int32_t main(int32_t argc, char **argv)
+{
+    std::mt19937_64 rng(0x5eed);
+    std::string source;
+    size_t lines = 1000000;
+    size_t count = 100000;
+    int32_t opt;
+
+    while ((opt = ::getopt(argc, argv, "l:n:f:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'l':
+                lines = std::max<size_t>(std::strtoull(optarg, nullptr, 10), 1);
+                break;
+
+            case 'n':
+                count = std::strtoull(optarg, nullptr, 10);
+                break;
+
+            case 'f':
+                source = optarg;
+                break;
+
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    // generated test files are written and removed by the benchmark itself
+    const bool generated = source.empty();
+    const char *tmpdir = std::getenv("TMPDIR") ? std::getenv("TMPDIR") : "/tmp";
+    const std::string prefix = std::string(tmpdir) + "/watte-bench-" + std::to_string(::getpid());
+    const std::string target = prefix + ".out";
+
+    if (generated)
+    {
+        TextBuffer content;
+
+        source = prefix + ".txt";
+        content.assign(makeContent(lines, rng));
+        if (!writeFile(content, source))
+        {
+            std::fprintf(stderr, "cannot write %s\n", source.c_str());
+            return 1;
+        }
+    }
+
+    TextBuffer buffer;
+    size_t checksum = 0; // keeps lookups from being optimized away
+    bool result = true;
+
+    std::printf("%-16s %9s %12s %10s %10s %10s %10s %10s\n", "phase", "ops", "ops/s", "p50 us",
+                "p90 us", "p99 us", "max us", "MB/s");
+
+    // loading = mapping plus indexing the whole file, the editor spreads the indexing over time and
+    // counts the line feeds on all cores
+    {
+        Phase phase("load");
+
+        phase.run(1, [&]() {
+            IndexJob indexer;
+
+            result = buffer.load(source);
+            indexer.start(buffer);
+            while (!buffer.complete())
+                indexer.take(buffer, true);
+        });
+        if (!result)
+        {
+            std::fprintf(stderr, "cannot load %s\n", source.c_str());
+            return 1;
+        }
+        phase.report(buffer.size() + 1);
+    }
+
+    // an unmodified buffer is copied by the kernel
+    {
+        Phase phase("save mapped");
+
+        phase.run(1, [&]() { result = writeFile(buffer, target) && result; });
+        phase.report(buffer.size() + 1);
+    }
+
+    // screen updates, every row is a line start lookup and the visible part of the line
+    {
+        Phase phase("scroll");
+
+        phase.run(count, [&]() {
+            const size_t sline = rng() % buffer.lines();
+
+            for (size_t line = sline; line < std::min(sline + rows, buffer.lines()); ++line)
+            {
+                const std::string row = buffer.text(buffer.lineStart(line),
+                                                    std::min(cols, buffer.lineLength(line)));
+
+                checksum += row.size();
+            }
+        });
+        phase.report();
+    }
+
+    {
+        Phase phase("line of pos");
+
+        phase.run(count, [&]() {
+            checksum += buffer.lineOf(rng() % std::max<size_t>(buffer.size(), 1));
+        });
+        phase.report();
+    }
+
+    // a needle which is not in the buffer makes every search scan all of it
+    {
+        Phase phase("search");
+        const size_t runs = 5;
+
+        phase.run(runs, [&]() { checksum += buffer.find("not in the buffer") != SIZE_MAX; });
+        phase.report(runs * buffer.size());
+    }
+
+    // the same on all cores, counting every match of a needle which is in the buffer
+    {
+        Phase phase("search threads");
+        const size_t runs = 5;
+        SearchJob search;
+
+        phase.run(runs, [&]() {
+            search.start(buffer, "\n", buffer.size() / 2);
+            search.wait();
+            checksum += search.count();
+        });
+        phase.report(runs * buffer.size());
+    }
+
+    // the lazy DFA over the whole buffer, with a pattern which never matches
+    {
+        Phase phase("regex search");
+        const size_t runs = 5;
+        TextBuffer::Range match;
+        Regex regex;
+
+        regex.compile("not [i]n the buffer");
+        phase.run(runs, [&]() { checksum += regex.find(buffer, 0, match); });
+        phase.report(runs * buffer.size());
+    }
+
+    // typing = single characters behind each other at one place
+    {
+        Phase phase("typing");
+        size_t pos = buffer.lineStart(rng() % buffer.lines());
+
+        phase.run(count, [&]() { buffer.insert(pos++, "x", 1); });
+        phase.report();
+    }
+
+    {
+        Phase phase("random insert");
+
+        phase.run(count, [&]() { buffer.insert(rng() % (buffer.size() + 1), "insert", 6); });
+        phase.report();
+    }
+
+    {
+        Phase phase("random erase");
+
+        phase.run(count, [&]() { buffer.erase(rng() % std::max<size_t>(buffer.size(), 1), 6); });
+        phase.report();
+    }
+
+    // ENTER splits a line at the cursor, BACKSPACE at the start of a line joins it again
+    {
+        Phase phase("line split");
+
+        phase.run(count, [&]() {
+            const size_t line = rng() % buffer.lines();
+
+            buffer.insert(buffer.lineStart(line) + (rng() % (buffer.lineLength(line) + 1)), "\n",
+                          1);
+        });
+        phase.report();
+    }
+
+    {
+        Phase phase("line join");
+
+        phase.run(count, [&]() {
+            const size_t line = 1 + (rng() % std::max<size_t>(buffer.lines() - 1, 1));
+
+            if (line < buffer.lines())
+                buffer.erase(buffer.lineStart(line) - 1, 1);
+        });
+        phase.report();
+    }
+
+    // every number of the buffer replaced, found in one pass and written anew in another one
+    {
+        Phase phase("replace all");
+        const size_t size = buffer.size();
+        Regex regex;
+
+        regex.compile("[0-9]+");
+        phase.run(1, [&]() {
+            std::vector<TextBuffer::Range> ranges;
+
+            regex.forEachMatch(buffer, 0, [&ranges](const TextBuffer::Range &match) {
+                ranges.push_back(match);
+                return true;
+            });
+            buffer.replace(ranges, "N");
+            checksum += ranges.size();
+        });
+        phase.report(size);
+    }
+
+    // edited buffers mix pieces of the file and of the add buffer
+    {
+        Phase phase("save edited");
+
+        phase.run(1, [&]() { result = writeFile(buffer, target) && result; });
+        phase.report(buffer.size() + 1);
+    }
+
+    struct rusage resources;
+
+    ::getrusage(RUSAGE_SELF, &resources);
+    std::printf("\nlines %zu, size %zu, checksum %zu, peak rss %ld KB\n", buffer.lines(),
+                buffer.size(), checksum, resources.ru_maxrss);
+
+    ::unlink(target.c_str());
+    if (generated)
+        ::unlink(source.c_str());
+
+    if (!result)
+    {
+        std::fprintf(stderr, "saving to %s failed\n", target.c_str());
+        return 1;
+    }
+
+    return 0;
+}
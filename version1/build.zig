@@ -7,8 +7,18 @@ comptime
         @compileError("building watte with Zig requires at least Zig 0.13.0");
 }
 
+// the terminal backend linked into a binary, raw needs no ncursesw
+const Terminal = enum
+{
+    none,
+    curses,
+    raw,
+};
+
 fn compileBinary(b: *std.Build, name: []const u8, rootdir: []const u8, flags: []const []const u8,
-                 sources: []const []const u8, target: std.Build.ResolvedTarget,
+                 sources: []const []const u8, c_flags: []const []const u8,
+                 c_sources: []const []const u8, terminal: Terminal,
+                 target: std.Build.ResolvedTarget,
                  optimize: std.builtin.OptimizeMode) !*std.Build.Step.Compile
 {
     const binary = b.addExecutable(
@@ -23,6 +33,13 @@ fn compileBinary(b: *std.Build, name: []const u8, rootdir: []const u8, flags: []
 
     try build_flags.appendSlice(b.allocator, flags);
     try cpp_sources.appendSlice(b.allocator, sources);
+    if (terminal == .curses)
+        try cpp_sources.appendSlice(b.allocator, sources_curses);
+    if (terminal == .raw)
+    {
+        try build_flags.append(b.allocator, "-DRAW_TERMINAL=1");
+        try cpp_sources.appendSlice(b.allocator, sources_raw);
+    }
 
     switch (target.result.os.tag)
     {
@@ -44,6 +61,7 @@ fn compileBinary(b: *std.Build, name: []const u8, rootdir: []const u8, flags: []
     }
 
     binary.addIncludePath(b.path(rootdir));
+    binary.addIncludePath(b.path(common_dir));
     binary.root_module.addCSourceFiles(
         .{
             .root = b.path(rootdir),
@@ -51,8 +69,17 @@ fn compileBinary(b: *std.Build, name: []const u8, rootdir: []const u8, flags: []
             .flags = build_flags.items,
         }
     );
+    binary.root_module.addCSourceFiles(
+        .{
+            .root = b.path(common_dir),
+            .files = c_sources,
+            .flags = c_flags,
+        }
+    );
     binary.linkLibCpp();
-    binary.linkSystemLibrary("ncurses");
+    if (terminal == .curses)
+        binary.linkSystemLibrary("ncursesw");
+    binary.linkSystemLibrary("pthread");
 
     return binary;
 }
@@ -64,20 +91,74 @@ const shared_flags = &[_][]const u8{
     "-Os",
 };
 
+const shared_c_flags = &[_][]const u8{
+    "-std=c11",
+    "-flto",
+    "-W", "-Wall", "-Wextra",
+    "-Os",
+};
+
+const common_dir = "../common";
+
+const sources_common = &[_][]const u8{
+    "linescan.c",
+    "memsearch.c",
+};
+
 const sources_watte = &[_][]const u8{
+    "batch.cxx",
+    "editor.cxx",
+    "fileio.cxx",
+    "history.cxx",
+    "indexer.cxx",
+    "journal.cxx",
+    "layout.cxx",
+    "regex.cxx",
+    "search.cxx",
+    "stats.cxx",
+    "syntax.cxx",
+    "textbuffer.cxx",
     "watte.cxx",
+    "workspace.cxx",
+};
+
+const sources_curses = &[_][]const u8{
+    "terminal.cxx",
+};
+
+const sources_raw = &[_][]const u8{
+    "rawterminal.cxx",
+};
+
+const sources_bench = &[_][]const u8{
+    "bench.cxx",
+    "fileio.cxx",
+    "indexer.cxx",
+    "regex.cxx",
+    "search.cxx",
+    "textbuffer.cxx",
 };
 
 pub fn build(b: *std.Build) !void
 {
     const target = b.standardTargetOptions(.{});
     const optimize = b.standardOptimizeOption(.{});
-    const watte_binary = try compileBinary(b, "watte", "./", shared_flags, sources_watte, target,
+    const raw = b.option(bool, "raw-terminal", "Draw with termios, without ncursesw") orelse false;
+    const terminal: Terminal = if (raw) .raw else .curses;
+    const watte_binary = try compileBinary(b, "watte", "./", shared_flags, sources_watte,
+                                           shared_c_flags, sources_common, terminal, target,
                                            optimize);
+    const bench_binary = try compileBinary(b, "bench", "./", shared_flags, sources_bench,
+                                           shared_c_flags, sources_common, .none, target, optimize);
     const run_watte = b.addRunArtifact(watte_binary);
+    const run_bench = b.addRunArtifact(bench_binary);
     const run_step_watte = b.step("run", "Run watte application");
+    const run_step_bench = b.step("bench", "Run buffer benchmarks");
 
     run_step_watte.dependOn(&run_watte.step);
+    if (b.args) |args|
+        run_bench.addArgs(args);
+    run_step_bench.dependOn(&run_bench.step);
 
     b.installArtifact(watte_binary);
 }
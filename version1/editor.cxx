@@ -0,0 +1,1121 @@
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include "editor.hxx"
+
+//--- public constructors ---
+
+Editor::Editor(const std::string &filename, const int32_t rows, const int32_t cols)
+: _buffer(), _history(), _journal(), _job(), _indexer(), _search(), _regex(), _filename(filename),
+#if DEBUG
+  _last_action(),
+#endif
+  _notice(), _query(), _last_query(), _replacement(), _jump_text(), _origin(0), _match(SIZE_MAX),
+  _match_length(0), _layouts(), _syntax(), _xpos(0), _goal(-1), _ypos(1), _sline(0), _srow(0),
+  _scol(0), _rows(std::max(rows, 1)), _cols(std::max(cols, 1)), _dirty_first(0),
+  _dirty_last(SIZE_MAX), _paste(false), _wrap(false), _finding(false), _searching(false),
+  _regex_mode(false), _replacing(false), _jumping(false), _running(true)
+{
+    _syntax.select(_filename);
+    if (loadFile())
+    {
+#if DEBUG
+        _last_action = "opened " + _filename;
+#endif
+    }
+    else
+    {
+        _buffer.clear();
+#if DEBUG
+        _last_action = "started new file " + _filename;
+#endif
+    }
+
+    // the line feeds of a large file are counted ahead of the view on all cores
+    _indexer.start(_buffer);
+
+    // edits of a session which ended without closing the buffer are applied again
+    if (const size_t edits = _journal.open(_filename, [this](const auto &ranges, const auto &text) {
+            return replay(ranges, text);
+        }))
+        _notice = "recovered " + std::to_string(edits) + " edits, (F2) saves them";
+    indexViewport();
+}
+
+//--- public methods ---
+
+void Editor::resize(const int32_t rows, const int32_t cols)
+{
+    _rows = std::max(rows, 1);
+    _cols = std::max(cols, 1);
+    _ypos = std::max(std::min(_ypos, _rows), 1);
+    _xpos = std::min(_xpos, lineWidth(_ypos + _sline - 1));
+    followCursor();
+}
+
+void Editor::processKeys(const std::vector<int32_t> &keys)
+{
+    std::string text;
+
+    _notice.clear();
+
+    // runs of typed or pasted characters become a single buffer insert, so do runs of the same
+    // cursor key, a line number is typed key by key
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        const int32_t key = keys[i];
+        int32_t count = 1;
+
+        if (key == key_paste_begin)
+            _paste = true;
+        else if (key == key_paste_end)
+            _paste = false;
+        else if ((isText(key) && !_jumping) || (_paste && (key == '\n')))
+            text += static_cast<char>(key);
+        else
+        {
+            applyText(text);
+            text.clear();
+            if (isVertical(key) && !_finding && !_jumping)
+                while (((i + count) < keys.size()) && (keys[i + count] == key))
+                    ++count;
+            processInput(key, count);
+            i += count - 1;
+            if (!_running)
+                return;
+        }
+    }
+    applyText(text);
+}
+
+void Editor::processInput(const int32_t key, const int32_t count)
+{
+    // keys are applied in batches, every one of them may move the view into unindexed lines
+    indexViewport();
+
+    // anything but typing and deleting ends the current undo record, anything but moving up and
+    // down forgets the column the cursor moves along
+    if ((key != key_backspace) && (key != key_delete) && !isText(key))
+        _history.seal();
+    if (!isVertical(key))
+        _goal = -1;
+
+    // while jumping, digits make up the line number, anything else ends it and is applied as usual
+    if (_jumping)
+    {
+        switch (key)
+        {
+            case key_backspace:
+                if (!_jump_text.empty())
+                    _jump_text.pop_back();
+                return;
+
+            case key_cancel:
+                _jumping = false;
+                return;
+
+            case '\n':
+                _jumping = false;
+                if (!_jump_text.empty())
+                    jumpTo(std::strtoull(_jump_text.c_str(), nullptr, 10));
+                return;
+
+            default:
+                if ((key >= '0') && (key <= '9'))
+                {
+                    _jump_text += static_cast<char>(key);
+                    return;
+                }
+                _jumping = false;
+        }
+    }
+
+    // while finding, keys edit the query or the replacement, everything else ends the search and is
+    // applied as usual, only keys going on from the match wait for a search still running, editing
+    // the query starts it again
+    if (_finding)
+    {
+        finishSearch();
+        switch (key)
+        {
+            case key_find:
+            case key_find_regex:
+                if (_replacing)
+                    return;
+                if (_query.empty())
+                    _query = _last_query;
+
+                // the other find key searches the query the other way, from the start again
+                if (_regex_mode != (key == key_find_regex))
+                {
+                    _regex_mode = !_regex_mode;
+                    search(_origin);
+                }
+                else
+                {
+                    finishSearch(true);
+                    search(((_match != SIZE_MAX) ? _match : _origin) + 1);
+                }
+                return;
+
+            case key_replace:
+                _replacing = !_query.empty();
+                _replacement.clear();
+                return;
+
+            case key_backspace:
+                if (_replacing)
+                {
+                    if (!_replacement.empty())
+                        _replacement.pop_back();
+                }
+                else if (!_query.empty())
+                {
+                    _query.pop_back();
+                    search(_origin);
+                }
+                return;
+
+            case key_cancel:
+                endFind(true);
+                return;
+
+            case '\n':
+                finishSearch(true);
+                if (_replacing)
+                    replaceAll();
+                endFind(false);
+                return;
+
+            default:
+                if (isText(key))
+                {
+                    findText(std::string(1, key));
+                    return;
+                }
+                endFind(false);
+        }
+    }
+
+    const char chr = key;
+    const size_t line = _ypos + _sline - 1;
+    int32_t old_xpos = _xpos;
+
+    switch (key)
+    {
+        case key_reload:
+            reloadFile();
+            break;
+
+        case key_save:
+            saveFile();
+            break;
+
+        case key_quit:
+            _running = false;
+            break;
+
+        // the view keeps its first line and the cursor its position
+        case key_wrap:
+            _wrap = !_wrap;
+            _srow = 0;
+            _scol = 0;
+            markLines(0, SIZE_MAX);
+            break;
+
+        case key_goto:
+            _jumping = true;
+            _jump_text.clear();
+            break;
+
+        case key_file_start:
+            jumpTo(0);
+            break;
+
+        case key_file_end:
+            jumpTo(SIZE_MAX);
+            break;
+
+        case key_find:
+        case key_find_regex:
+            _finding = true;
+            _regex_mode = key == key_find_regex;
+            _replacing = false;
+            _query.clear();
+            _origin = _buffer.lineStart(line) + _xpos;
+            _match = SIZE_MAX;
+            break;
+
+        // replacing outside of a find replaces what was found last, the way it was found
+        case key_replace:
+            if (!_last_query.empty())
+            {
+                _finding = true;
+                _replacing = true;
+                _query = _last_query;
+                _replacement.clear();
+                _origin = _buffer.lineStart(line) + _xpos;
+                _match = SIZE_MAX;
+            }
+            break;
+
+        case key_undo:
+        case key_redo:
+        {
+            const size_t size = _buffer.size();
+            size_t start;
+            size_t end;
+
+            if ((key == key_undo) ? _history.undo(_buffer, start, end)
+                                  : _history.redo(_buffer, start, end))
+            {
+                _journal.replaced(_buffer, start, size + (end - start) - _buffer.size(),
+                                  end - start);
+                changed(_buffer.lineOf(start), SIZE_MAX);
+                moveTo(end);
+            }
+            break;
+        }
+
+        // pages are half of the view, wrapped lines are moved through row by row and the view
+        // follows the cursor afterwards
+        case key_up:
+        case key_down:
+        case key_page_up:
+        case key_page_down:
+        {
+            const int32_t step = ((key == key_up) || (key == key_down)) ? 1 : (_rows / 2);
+            const int32_t moves = ((key == key_up) || (key == key_page_up)) ? -count : count;
+
+            if (_goal < 0)
+                _goal = column();
+            if (_wrap)
+            {
+                moveRows(moves * step);
+                break;
+            }
+            moveLines(moves, step);
+            _xpos = layout(_ypos + _sline - 1).offsetOf(_goal);
+            break;
+        }
+
+        // the cursor moves over whole characters, deleting removes them with everything joined to
+        // them
+        case key_left:
+            _xpos = layout(line).previous(_xpos);
+            break;
+
+        case key_right:
+            _xpos = layout(line).next(_xpos);
+            break;
+
+        case key_delete:
+            if (_xpos < lineWidth(line))
+            {
+                const size_t length = layout(line).next(_xpos) - _xpos;
+
+                erase(_buffer.lineStart(line) + _xpos, length);
+                edited(line, _xpos, length, 0);
+            }
+            else if ((line + 1) < _buffer.lines()) // line wrapping delete
+            {
+                erase(_buffer.lineStart(line) + _buffer.lineLength(line), 1);
+                changed(line, SIZE_MAX);
+            }
+            break;
+
+        case key_backspace:
+            if (_xpos > 0)
+            {
+                old_xpos = _xpos;
+                _xpos = layout(line).previous(_xpos);
+                erase(_buffer.lineStart(line) + _xpos, old_xpos - _xpos);
+                edited(line, _xpos, old_xpos - _xpos, 0);
+            }
+            else if (line > 0) // line wrapping backspace
+            {
+                old_xpos = _buffer.lineLength(line - 1);
+                erase(_buffer.lineStart(line) - 1, 1);
+                changed(line - 1, SIZE_MAX);
+                moveLines(-1, 1);
+                _xpos = std::min(old_xpos, lineWidth(line - 1));
+            }
+            break;
+
+        case key_home:
+            _xpos = 0;
+            break;
+
+        case key_end:
+            _xpos = lineWidth(line);
+            break;
+
+        case '\n':
+            insert(_buffer.lineStart(line) + _xpos, "\n", 1);
+            changed(line, SIZE_MAX);
+            moveLines(1, 1);
+            _xpos = 0;
+            break;
+
+        default:
+            if (isText(key))
+            {
+                insert(_buffer.lineStart(line) + _xpos, &chr, 1);
+                edited(line, _xpos++, 0, 1);
+            }
+    }
+    followCursor();
+}
+
+void Editor::insertText(const std::string &text)
+{
+    const size_t line = _ypos + _sline - 1;
+    const size_t lfs = std::count(text.begin(), text.end(), '\n');
+
+    if (text.empty())
+        return;
+
+    _goal = -1;
+    insert(_buffer.lineStart(line) + _xpos, text);
+    if (lfs)
+        changed(line, SIZE_MAX);
+    else
+        edited(line, _xpos, 0, text.size());
+
+    // the cursor ends up behind the inserted text, scrolled into view if necessary
+    if (lfs)
+    {
+        const size_t cursor = line + lfs;
+
+        if (cursor >= (_sline + _rows))
+            _sline = cursor - _rows + 1;
+        _ypos = cursor - _sline + 1;
+        _xpos = std::min<int32_t>(text.size() - text.rfind('\n') - 1, lineWidth(cursor));
+    }
+    else
+        _xpos = std::min<int32_t>(_xpos + text.size(), lineWidth(line));
+    followCursor();
+}
+
+void Editor::findText(const std::string &text)
+{
+    if (text.empty())
+        return;
+    if (_replacing)
+    {
+        _replacement += text;
+        return;
+    }
+
+    const bool running = _searching && !finishSearch();
+    const bool found = _query.empty() || (_match != SIZE_MAX);
+
+    // a longer query only matches where the shorter one did, so the search continues at the last
+    // match and a query which was not found stays not found, a pattern may match anywhere again,
+    // a search still running is not waited for, the longer query is searched from the start again
+    _query += text;
+    if (_regex_mode || running)
+        search(_origin);
+    else if (found)
+        search((_match != SIZE_MAX) ? _match : _origin);
+}
+
+bool Editor::loadFile()
+{
+    return _buffer.load(_filename);
+}
+
+bool Editor::reloadFile()
+{
+    return _job.load(_filename);
+}
+
+bool Editor::saveFile()
+{
+    if (!_job.save(_buffer, _filename))
+        return false;
+
+    // edits from now on are not part of the saved file, the journal keeps them
+    _journal.mark();
+
+    return true;
+}
+
+bool Editor::finishJob(const bool wait)
+{
+    const FileJob::Type type = _job.type();
+
+    if ((type == FileJob::Type::none) || (!wait && !_job.done()))
+        return false;
+
+    // a reload replaces the buffer, including everything typed while it was running
+    const bool result = _job.finish(_buffer);
+
+    if (type == FileJob::Type::load)
+    {
+        _notice = result ? "reloaded" : "reloading failed";
+        if (result)
+        {
+            _indexer.cancel();
+            _history.clear();
+            _journal.reset();
+            _xpos = 0;
+            _ypos = 1;
+            _sline = 0;
+            _srow = 0;
+            _scol = 0;
+            changed(0, SIZE_MAX);
+        }
+    }
+    else
+    {
+        _notice = result ? "saved" : "saving failed";
+        _journal.saved(result);
+    }
+#if DEBUG
+    _last_action = _notice + " " + _filename;
+#endif
+
+    return result;
+}
+
+bool Editor::finishSearch(const bool wait)
+{
+    if (!_searching || (!wait && !_search.found()))
+        return false;
+
+    _searching = false;
+    showMatch(_search.match(), _query.size());
+
+    return true;
+}
+
+void Editor::setUndoLimit(const size_t bytes)
+{
+    _history.setLimit(bytes);
+}
+
+size_t Editor::index(const bool wait)
+{
+    return _indexer.take(_buffer, wait);
+}
+
+void Editor::indexViewport()
+{
+    // enough lines for the view and a half page jump
+    _buffer.indexLines(_sline + _rows + _rows);
+}
+
+void Editor::compact()
+{
+    // a find in progress is done, memory only needed while working on the buffer is given back
+    if (_finding)
+        endFind(false);
+    _regex.release();
+    _buffer.release();
+}
+
+void Editor::markLines(const size_t first, const size_t last)
+{
+    _dirty_first = std::min(_dirty_first, first);
+    _dirty_last = std::max(_dirty_last, last);
+}
+
+void Editor::clearDirty()
+{
+    _dirty_first = SIZE_MAX;
+    _dirty_last = 0;
+}
+
+void Editor::highlight(const size_t first, const size_t last)
+{
+    // a comment opened or closed changes how the lines behind it look as well
+    const size_t changed = _syntax.update(_buffer, first, last);
+
+    if (changed != SIZE_MAX)
+        markLines(changed, SIZE_MAX);
+}
+
+int32_t Editor::lineWidth(const size_t line) const
+{
+    return std::min<size_t>(_buffer.lineLength(line), INT32_MAX);
+}
+
+LineLayout &Editor::layout(const size_t line)
+{
+    const bool top = (line == _sline);
+
+    // wrapped lines show their rows from the top of the view on, at most a view full of them
+    if (_wrap)
+        return _layouts.get(_buffer, line, top ? (_srow * _cols) : 0, _rows * _cols);
+
+    return _layouts.get(_buffer, line, _scol, _cols);
+}
+
+int32_t Editor::lineRows(const size_t line)
+{
+    // a wrapped line with a full last row gets another one, the cursor behind it needs it
+    return _wrap ? ((layout(line).width() / _cols) + 1) : 1;
+}
+
+int32_t Editor::column()
+{
+    return layout(_ypos + _sline - 1).columnOf(_xpos);
+}
+
+int32_t Editor::lineRow(const size_t line)
+{
+    int32_t row = 1 - _srow;
+
+    // the first row of a line, wrapped lines above it take all of their rows
+    if (!_wrap)
+        return static_cast<int64_t>(line) - static_cast<int64_t>(_sline) + 1;
+
+    for (size_t above = _sline; above < line; ++above)
+        row += lineRows(above);
+
+    return row;
+}
+
+int32_t Editor::cursorRow()
+{
+    return _wrap ? (lineRow(_ypos + _sline - 1) + (column() / _cols)) : _ypos;
+}
+
+int32_t Editor::cursorColumn()
+{
+    return _wrap ? (column() % _cols) : (column() - _scol);
+}
+
+// bytes of UTF-8 sequences are text as well, they arrive one after the other
+bool Editor::isText(const int32_t key)
+{
+    return (key >= 0) && (key < 256) && (std::isprint(key) || (key == '\t') || (key >= 0x80));
+}
+
+const TextBuffer &Editor::buffer() const
+{
+    return _buffer;
+}
+
+const Syntax &Editor::syntax() const
+{
+    return _syntax;
+}
+
+const std::string &Editor::filename() const
+{
+    return _filename;
+}
+
+const std::string &Editor::notice() const
+{
+    return _notice;
+}
+
+#if DEBUG
+const std::string &Editor::lastAction() const
+{
+    return _last_action;
+}
+#endif
+
+const FileJob &Editor::job() const
+{
+    return _job;
+}
+
+const IndexJob &Editor::indexJob() const
+{
+    return _indexer;
+}
+
+const SearchJob &Editor::searchJob() const
+{
+    return _search;
+}
+
+const Regex &Editor::regex() const
+{
+    return _regex;
+}
+
+bool Editor::finding() const
+{
+    return _finding;
+}
+
+bool Editor::searching() const
+{
+    return _searching;
+}
+
+bool Editor::regexMode() const
+{
+    return _regex_mode;
+}
+
+bool Editor::replacing() const
+{
+    return _replacing;
+}
+
+bool Editor::jumping() const
+{
+    return _jumping;
+}
+
+const std::string &Editor::query() const
+{
+    return _query;
+}
+
+const std::string &Editor::jumpText() const
+{
+    return _jump_text;
+}
+
+const std::string &Editor::replacement() const
+{
+    return _replacement;
+}
+
+size_t Editor::match() const
+{
+    return _match;
+}
+
+size_t Editor::matchLength() const
+{
+    return _match_length;
+}
+
+int32_t Editor::xpos() const
+{
+    return _xpos;
+}
+
+int32_t Editor::ypos() const
+{
+    return _ypos;
+}
+
+size_t Editor::sline() const
+{
+    return _sline;
+}
+
+int32_t Editor::srow() const
+{
+    return _srow;
+}
+
+int32_t Editor::scol() const
+{
+    return _scol;
+}
+
+int32_t Editor::rows() const
+{
+    return _rows;
+}
+
+int32_t Editor::cols() const
+{
+    return _cols;
+}
+
+size_t Editor::dirtyFirst() const
+{
+    return _dirty_first;
+}
+
+size_t Editor::dirtyLast() const
+{
+    return _dirty_last;
+}
+
+bool Editor::paste() const
+{
+    return _paste;
+}
+
+bool Editor::wrapped() const
+{
+    return _wrap;
+}
+
+bool Editor::running() const
+{
+    return _running;
+}
+
+//--- private methods ---
+
+void Editor::insert(const size_t pos, const char *data, const size_t length)
+{
+    // the buffer puts text behind its end at the end, undo and the journal have to know it there
+    const size_t at = std::min(pos, _buffer.size());
+
+    _buffer.insert(at, data, length);
+    _history.inserted(_buffer, at, length);
+    _journal.replaced(_buffer, at, 0, length);
+}
+
+void Editor::insert(const size_t pos, const std::string &text)
+{
+    insert(pos, text.data(), text.size());
+}
+
+void Editor::erase(const size_t pos, const size_t length)
+{
+    TextBuffer::Span removed = _buffer.erase(pos, length);
+
+    _journal.replaced(_buffer, pos, removed.size(), 0);
+    _history.erased(_buffer, pos, std::move(removed));
+}
+
+void Editor::moveTo(const size_t pos)
+{
+    // positions found in the unindexed tail have no line number yet
+    while (!_buffer.complete() && (pos >= _buffer.size()))
+        index(true);
+
+    const size_t line = _buffer.lineOf(pos);
+
+    // a line outside of the view is put into the middle of it
+    if ((line < _sline) || (line >= (_sline + _rows)))
+    {
+        _sline = (line > static_cast<size_t>(_rows / 2)) ? (line - (_rows / 2)) : 0;
+        _srow = 0;
+    }
+    indexViewport();
+    _ypos = line - _sline + 1;
+
+    // a position inside of a character puts the cursor in front of it
+    LineLayout &layout = this->layout(line);
+
+    _xpos = layout.offsetOf(layout.columnOf(pos - _buffer.lineStart(line)));
+    _goal = -1;
+    followCursor();
+}
+
+void Editor::jumpTo(const size_t line)
+{
+    // lines behind the indexed ones are indexed first, a line behind the last one is the last one,
+    // the view does not show more than a page behind it
+    while (!_buffer.complete() && (_buffer.lines() <= line))
+        index(true);
+
+    const size_t lines = _buffer.lines();
+    const size_t target = std::min(line, lines - 1);
+    const size_t top = (lines > static_cast<size_t>(_rows)) ? (lines - _rows) : 0;
+
+    moveTo(_buffer.lineStart(target));
+    if (!_wrap && (_sline > top))
+    {
+        _sline = top;
+        _ypos = target - _sline + 1;
+    }
+}
+
+void Editor::applyText(const std::string &text)
+{
+    if (_finding)
+        findText(text);
+    else
+        insertText(text);
+}
+
+void Editor::search(const size_t pos)
+{
+    if (_match != SIZE_MAX)
+        markLines(_buffer.lineOf(_match), _buffer.lineOf(_match) + 1);
+    _match = SIZE_MAX;
+
+    if (_query.empty())
+    {
+        _search.cancel();
+        _searching = false;
+        moveTo(_origin);
+        return;
+    }
+
+    // patterns are searched right away and wrap around at the end of the buffer, plain text is
+    // searched by the workers on a snapshot, its first match is applied once they found it
+    if (_regex_mode)
+    {
+        TextBuffer::Range match = {SIZE_MAX, 0};
+
+        if (_regex.pattern() != _query)
+            _regex.compile(_query);
+        if (!_regex.find(_buffer, pos, match) && pos)
+            _regex.find(_buffer, 0, match);
+        showMatch(match.pos, match.length);
+        return;
+    }
+    _search.start(_buffer, _query, pos);
+    _searching = true;
+}
+
+void Editor::showMatch(const size_t match, const size_t length)
+{
+    _match = match;
+    _match_length = length;
+    moveTo((_match != SIZE_MAX) ? _match : _origin);
+    if (_match != SIZE_MAX)
+        markLines(_buffer.lineOf(_match), _buffer.lineOf(_match) + 1);
+}
+
+void Editor::replace(const std::vector<TextBuffer::Range> &ranges, const std::string &text)
+{
+    // the buffer is rebuilt in one pass, undo gets a single record from the first to the last range
+    const size_t first = ranges.front().pos;
+    const size_t last = ranges.back().pos + ranges.back().length;
+    const size_t cursor = _buffer.lineStart(_ypos + _sline - 1) + _xpos;
+    TextBuffer::Span span = _buffer.slice(first, last - first);
+    size_t removed = 0;
+
+    for (const TextBuffer::Range &range : ranges)
+        removed += range.length;
+    _buffer.replace(ranges, text);
+    _history.replaced(_buffer, first, std::move(span),
+                      last - first - removed + ranges.size() * text.size());
+    _journal.replaced(ranges, text);
+    changed(_buffer.lineOf(first), SIZE_MAX);
+
+    // the lines of the cursor may be joined or gone, it stays at the same text instead
+    moveTo(shifted(ranges, text.size(), cursor));
+}
+
+void Editor::replaceAll()
+{
+    std::vector<TextBuffer::Range> ranges;
+
+    // all matches of the whole file from the front to the back, they never overlap, an empty match
+    // of a pattern does not stop the search from moving on
+    while (!_buffer.complete())
+        index(true);
+    if (!_regex_mode)
+        _buffer.forEachMatch(_query, 0, SIZE_MAX, [&](size_t pos) {
+            if (ranges.empty() || (pos >= (ranges.back().pos + ranges.back().length)))
+                ranges.push_back({pos, _query.size()});
+            return true;
+        });
+    else if ((_regex.pattern() == _query) || _regex.compile(_query))
+        _regex.forEachMatch(_buffer, 0, [&ranges](const TextBuffer::Range &match) {
+            ranges.push_back(match);
+            return true;
+        });
+
+    if (_match != SIZE_MAX)
+        markLines(_buffer.lineOf(_match), _buffer.lineOf(_match) + 1);
+    _match = SIZE_MAX;
+    _notice = "replaced " + std::to_string(ranges.size()) + " matches";
+    if (ranges.empty())
+        return;
+
+    _origin = shifted(ranges, _replacement.size(), _origin);
+    replace(ranges, _replacement);
+}
+
+bool Editor::replay(const std::vector<TextBuffer::Range> &ranges, const std::string &text)
+{
+    // journal positions are positions in the whole file
+    while (!_buffer.complete())
+        index(true);
+    if (ranges.empty() || ((ranges.back().pos + ranges.back().length) > _buffer.size()))
+        return false;
+
+    // typing and deleting are applied the same way as before, so undo joins them again
+    if ((ranges.size() == 1) && !ranges[0].length)
+        insert(ranges[0].pos, text);
+    else if ((ranges.size() == 1) && text.empty())
+        erase(ranges[0].pos, ranges[0].length);
+    else
+        replace(ranges, text);
+
+    return true;
+}
+
+void Editor::changed(const size_t first, const size_t last)
+{
+    _layouts.invalidate(first, last);
+    _syntax.invalidate(first);
+    markLines(first, last);
+}
+
+void Editor::edited(const size_t line, const size_t offset, const size_t removed,
+                    const size_t inserted)
+{
+    // a wrapped line may get more or less rows and move the lines below it
+    _layouts.edited(line, offset, removed, inserted);
+    _syntax.edited(line);
+    markLines(line, _wrap ? SIZE_MAX : (line + 1));
+}
+
+void Editor::moveLines(int32_t count, const int32_t step)
+{
+    // every move takes the cursor step lines through the view, once it is at an edge of the view
+    // the view scrolls instead, the view is only scrolled as far as there are lines, only numbers
+    // are moved until the cursor stops
+    if (count > 0)
+        _buffer.indexLines(_sline + _rows + (static_cast<size_t>(count) * step));
+
+    const size_t lines = _buffer.lines();
+
+    for (; count < 0; ++count)
+    {
+        const int32_t ypos = _ypos;
+
+        _ypos = std::max(_ypos - step, 1);
+        if (ypos == _ypos)
+            _sline -= std::min<size_t>(_sline, step);
+    }
+    for (; count > 0; --count)
+    {
+        const size_t below = (lines > _sline) ? (lines - _sline) : 0;
+        const int32_t ypos = _ypos;
+
+        _ypos = std::min<size_t>(_ypos + step, std::min<size_t>(_rows, below));
+        if ((ypos == _ypos) && (below > static_cast<size_t>(_rows)))
+            _sline = std::min(_sline + step, lines - _rows);
+    }
+}
+
+void Editor::moveRows(const int32_t count)
+{
+    size_t line = _ypos + _sline - 1;
+    int32_t row = column() / _cols;
+
+    // the cursor keeps its column inside of the row it moves to
+    stepRows(line, row, count);
+    _ypos = static_cast<int64_t>(line) - static_cast<int64_t>(_sline) + 1;
+    _xpos = layout(line).offsetOf((row * _cols) + (_goal % _cols));
+}
+
+void Editor::stepRows(size_t &line, int32_t &row, int32_t count)
+{
+    for (; count < 0; ++count)
+    {
+        if (row > 0)
+            --row;
+        else if (line > 0)
+            row = lineRows(--line) - 1;
+        else
+            break;
+    }
+    for (; count > 0; --count)
+    {
+        if ((row + 1) < lineRows(line))
+            ++row;
+        else if ((line + 1) < _buffer.lines())
+        {
+            ++line;
+            row = 0;
+        }
+        else
+            break;
+    }
+}
+
+void Editor::followCursor()
+{
+    const int32_t column = this->column();
+    const int32_t scol = _scol;
+    const int32_t srow = _srow;
+
+    // wrapped lines move the top of the view up to the cursor row, or down until the cursor row is
+    // the last one, otherwise the view jumps by half of its width, so moving along a line does not
+    // scroll it every column
+    if (_wrap)
+    {
+        const size_t line = _ypos + _sline - 1;
+        const int32_t row = column / _cols;
+        int32_t rows = row - _srow;
+
+        _srow = std::min(_srow, lineRows(_sline) - 1);
+        for (size_t above = _sline; (above < line) && (rows < _rows); ++above)
+            rows += lineRows(above);
+
+        if ((line < _sline) || ((line == _sline) && (row < _srow)))
+        {
+            _sline = line;
+            _srow = row;
+        }
+        else if (rows >= _rows)
+        {
+            size_t top = line;
+            int32_t top_row = row;
+
+            stepRows(top, top_row, 1 - _rows);
+            _sline = top;
+            _srow = top_row;
+        }
+        _ypos = line - _sline + 1;
+    }
+    else if ((column < _scol) || (column >= (_scol + _cols)))
+        _scol = std::max(column - (_cols / 2), 0);
+
+    if ((_scol != scol) || (_srow != srow))
+        markLines(0, SIZE_MAX);
+}
+
+void Editor::endFind(const bool cancel)
+{
+    // a cancelled search is dropped, its match is not waited for
+    if (cancel)
+        _searching = false;
+    else
+        finishSearch(true);
+    _search.cancel();
+    if (_match != SIZE_MAX)
+        markLines(_buffer.lineOf(_match), _buffer.lineOf(_match) + 1);
+    if (cancel)
+        moveTo(_origin);
+    if (!_query.empty())
+        _last_query = _query;
+    _finding = false;
+    _replacing = false;
+    _match = SIZE_MAX;
+}
+
+bool Editor::isVertical(const int32_t key)
+{
+    return (key == key_up) || (key == key_down) || (key == key_page_up) || (key == key_page_down);
+}
+
+size_t Editor::shifted(const std::vector<TextBuffer::Range> &ranges, const size_t length,
+                       const size_t pos)
+{
+    size_t result = pos;
+
+    // ranges in front of the position move it by their change in size, a range around it puts it
+    // behind its replacement
+    for (const TextBuffer::Range &range : ranges)
+    {
+        if (range.pos >= pos)
+            break;
+        result = result - (std::min(pos, range.pos + range.length) - range.pos) + length;
+    }
+
+    return result;
+}
@@ -0,0 +1,219 @@
+#pragma once
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "fileio.hxx"
+#include "history.hxx"
+#include "indexer.hxx"
+#include "journal.hxx"
+#include "layout.hxx"
+#include "regex.hxx"
+#include "search.hxx"
+#include "syntax.hxx"
+#include "textbuffer.hxx"
+
+// Keys of the editor core. Characters are their own key code, everything else comes after them.
+// Frontends and scripts translate their input into these codes.
+enum Key : int32_t {
+    key_up = 256,
+    key_down,
+    key_left,
+    key_right,
+    key_home,
+    key_end,
+    key_page_up,
+    key_page_down,
+    key_backspace,
+    key_delete,
+    key_reload,
+    key_save,
+    key_quit,
+    key_undo,
+    key_redo,
+    key_find,
+    key_find_regex,
+    key_replace,
+    key_next_buffer,
+    key_previous_buffer,
+    key_wrap,
+    key_goto,
+    key_file_start,
+    key_file_end,
+    key_cancel,
+    key_paste_begin,
+    key_paste_end
+};
+
+// The editor without a terminal: the buffer, the cursor and the visible part of the buffer, all
+// driven by keys. A frontend tells the editor the size of the view and draws what it reports, edited
+// lines are collected as a dirty line range for it. Batch mode runs the editor without a frontend.
+// The cursor is a byte offset into its line, the layout of the line tells the column it is shown at.
+// Lines wider than the view scroll sideways with the cursor, all of them by the same columns. In wrap
+// mode they are split into rows of the view width instead, the top of the view is a row of its first
+// line then. The rows of a line come from the width its layout keeps, edits and resizing only change
+// the rows of the lines they touch. Source code is highlighted by the syntax of its file name, lines
+// are lexed once they are shown.
+// Moving up and down keeps the column the cursor started at. A held key arrives as a run of the
+// same key and is applied as one move. Without wrap only the line the cursor stops at is laid out,
+// in wrap mode every line it passes is laid out once to count its rows.
+// A file is shown and edited while its lines are still counted, an index job counts the pieces of
+// a large file on all cores and the frontend takes them into the buffer whenever it is idle.
+class Editor {
+public:
+    //--- public constructors ---
+    Editor(const std::string &filename, const int32_t rows, const int32_t cols);
+    Editor(const Editor &rhs) = delete;
+    Editor(Editor &&rhs) = delete;
+    ~Editor() noexcept = default;
+
+    //--- public operators ---
+    Editor &operator=(const Editor &rhs) = delete;
+    Editor &operator=(Editor &&rhs) = delete;
+
+    //--- public methods ---
+    void resize(const int32_t rows, const int32_t cols);
+    void processKeys(const std::vector<int32_t> &keys);
+    void processInput(const int32_t key, const int32_t count = 1);
+    void insertText(const std::string &text);
+    void findText(const std::string &text);
+
+    bool loadFile();
+    bool reloadFile();
+    bool saveFile();
+    bool finishJob(const bool wait = false);
+    bool finishSearch(const bool wait = false);
+    void setUndoLimit(const size_t bytes);
+    size_t index(const bool wait = false);
+    void indexViewport();
+    void compact();
+
+    void markLines(const size_t first, const size_t last);
+    void clearDirty();
+    void highlight(const size_t first, const size_t last);
+    int32_t lineWidth(const size_t line) const;
+    LineLayout &layout(const size_t line);
+    int32_t lineRows(const size_t line);
+    int32_t lineRow(const size_t line);
+    int32_t column();
+    int32_t cursorRow();
+    int32_t cursorColumn();
+    static bool isText(const int32_t key);
+
+    const TextBuffer &buffer() const;
+    const Syntax &syntax() const;
+    const std::string &filename() const;
+    const std::string &notice() const;
+#if DEBUG
+    const std::string &lastAction() const;
+#endif
+    const FileJob &job() const;
+    const IndexJob &indexJob() const;
+    const SearchJob &searchJob() const;
+    const Regex &regex() const;
+    bool finding() const;
+    bool searching() const;
+    bool regexMode() const;
+    bool replacing() const;
+    bool jumping() const;
+    const std::string &query() const;
+    const std::string &jumpText() const;
+    const std::string &replacement() const;
+    size_t match() const;
+    size_t matchLength() const;
+    int32_t xpos() const;
+    int32_t ypos() const;
+    size_t sline() const;
+    int32_t srow() const;
+    int32_t scol() const;
+    int32_t rows() const;
+    int32_t cols() const;
+    size_t dirtyFirst() const;
+    size_t dirtyLast() const;
+    bool paste() const;
+    bool wrapped() const;
+    bool running() const;
+
+private:
+    //--- private methods ---
+    void insert(const size_t pos, const char *data, const size_t length);
+    void insert(const size_t pos, const std::string &text);
+    void erase(const size_t pos, const size_t length);
+    void moveTo(const size_t pos);
+    void jumpTo(const size_t line);
+    void applyText(const std::string &text);
+    void search(const size_t pos);
+    void showMatch(const size_t match, const size_t length);
+    void replace(const std::vector<TextBuffer::Range> &ranges, const std::string &text);
+    void replaceAll();
+    bool replay(const std::vector<TextBuffer::Range> &ranges, const std::string &text);
+    void changed(const size_t first, const size_t last);
+    void edited(const size_t line, const size_t offset, const size_t removed,
+                const size_t inserted);
+    void moveLines(int32_t count, const int32_t step);
+    void moveRows(const int32_t count);
+    void stepRows(size_t &line, int32_t &row, int32_t count);
+    void followCursor();
+    void endFind(const bool cancel);
+    static bool isVertical(const int32_t key);
+    static size_t shifted(const std::vector<TextBuffer::Range> &ranges, const size_t length,
+                          const size_t pos);
+
+    //--- private properties ---
+    TextBuffer _buffer;
+    History _history;
+    Journal _journal;
+    FileJob _job;
+    IndexJob _indexer;
+    SearchJob _search;
+    Regex _regex;
+    std::string _filename;
+#if DEBUG
+    std::string _last_action;
+#endif
+    std::string _notice;
+    std::string _query;
+    std::string _last_query;
+    std::string _replacement;
+    std::string _jump_text;
+    size_t _origin;
+    size_t _match;
+    size_t _match_length;
+    LayoutCache _layouts;
+    Syntax _syntax;
+    int32_t _xpos;
+    int32_t _goal;
+    int32_t _ypos;
+    size_t _sline;
+    int32_t _srow;
+    int32_t _scol;
+    int32_t _rows;
+    int32_t _cols;
+    size_t _dirty_first;
+    size_t _dirty_last;
+    bool _paste;
+    bool _wrap;
+    bool _finding;
+    bool _searching;
+    bool _regex_mode;
+    bool _replacing;
+    bool _jumping;
+    bool _running;
+};
@@ -0,0 +1,351 @@
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "fileio.hxx"
+#include "indexer.hxx"
+
+// kernel side copies are split into steps of this size to report progress in between
+const size_t copy_step = 16 * 1024 * 1024;
+
+// the umask can only be read by setting it and it is shared by all threads, it is read once while
+// the program starts, before any thread is running
+static const mode_t file_mask = []() {
+    const mode_t mask = ::umask(0);
+
+    ::umask(mask);
+
+    return mask;
+}();
+
+// Collects the spans of a buffer in document order. Memory spans are written with writev() in
+// batches of IOV_MAX, consecutive spans of the mapped original become one kernel side copy.
+class SpanWriter {
+public:
+    //--- public constructors ---
+    SpanWriter(const int32_t fd, const TextBuffer::Source &source, const ProgressFunc &progress)
+    : _iov(), _source(source), _progress(progress), _fd(fd), _copy_offset(0), _copy_length(0),
+      _written(0)
+    {
+        _iov.reserve(IOV_MAX);
+    }
+
+    SpanWriter(const SpanWriter &rhs) = delete;
+    SpanWriter(SpanWriter &&rhs) = delete;
+    ~SpanWriter() noexcept = default;
+
+    //--- public operators ---
+    SpanWriter &operator=(const SpanWriter &rhs) = delete;
+    SpanWriter &operator=(SpanWriter &&rhs) = delete;
+
+    //--- public methods ---
+    bool add(const char *data, const size_t length)
+    {
+        if (_source.data && (data >= _source.data) && (data < (_source.data + _source.size)))
+        {
+            const off_t offset = data - _source.data;
+
+            if (_copy_length && (offset == static_cast<off_t>(_copy_offset + _copy_length)))
+            {
+                _copy_length += length;
+                return true;
+            }
+            if (!flush())
+                return false;
+            _copy_offset = offset;
+            _copy_length = length;
+
+            return true;
+        }
+
+        if (_copy_length && !copyRange())
+            return false;
+        _iov.push_back({const_cast<char *>(data), length});
+
+        return (_iov.size() < IOV_MAX) || writeBatch();
+    }
+
+    bool flush()
+    {
+        return writeBatch() && copyRange();
+    }
+
+private:
+    //--- private methods ---
+    bool writeBatch()
+    {
+        iovec *iov = _iov.data();
+        int32_t count = _iov.size();
+
+        while (count > 0)
+        {
+            ssize_t written = ::writev(_fd, iov, count);
+
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+
+            _written += written;
+
+            // partial writes continue with the first entry not completely written
+            while (count && (static_cast<size_t>(written) >= iov->iov_len))
+            {
+                written -= iov->iov_len;
+                ++iov;
+                --count;
+            }
+            if (count)
+            {
+                iov->iov_base = static_cast<char *>(iov->iov_base) + written;
+                iov->iov_len -= written;
+            }
+        }
+        _iov.clear();
+        report();
+
+        return true;
+    }
+
+    bool copyRange()
+    {
+        off_t offset = _copy_offset;
+
+#ifdef __linux__
+        while (_copy_length)
+        {
+            const ssize_t copied = ::copy_file_range(_source.fd, &offset, _fd, nullptr,
+                                                     std::min(_copy_length, copy_step), 0);
+
+            if (copied <= 0)
+            {
+                if ((copied < 0) && (errno == EINTR))
+                    continue;
+                break;
+            }
+            _copy_length -= copied;
+            _written += copied;
+            report();
+        }
+#endif
+
+        // no kernel side copy available (other file system, old kernel), write the mapping
+        while (_copy_length)
+        {
+            const ssize_t written = ::write(_fd, _source.data + offset, _copy_length);
+
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            offset += written;
+            _copy_length -= written;
+            _written += written;
+            report();
+        }
+
+        return true;
+    }
+
+    void report()
+    {
+        if (_progress)
+            _progress(_written);
+    }
+
+    //--- private properties ---
+    std::vector<iovec> _iov;
+    TextBuffer::Source _source;
+    const ProgressFunc &_progress;
+    int32_t _fd;
+    off_t _copy_offset;
+    size_t _copy_length;
+    size_t _written;
+};
+
+//--- file functions ---
+
+bool writeFile(const TextBuffer &buffer, const std::string &filename, const ProgressFunc &progress)
+{
+    char *resolved = ::realpath(filename.c_str(), nullptr);
+    const std::string target = resolved ? resolved : filename;
+    const size_t slash = target.rfind('/');
+    const std::string dirname = (slash == std::string::npos) ? "." : target.substr(0, slash + 1);
+    std::string tmpname = (slash == std::string::npos) ? ("." + target + ".XXXXXX")
+                          : (dirname + "." + target.substr(slash + 1) + ".XXXXXX");
+    struct stat st;
+    int32_t fd;
+    bool result;
+
+    std::free(resolved);
+
+    fd = ::mkstemp(tmpname.data());
+    if (fd < 0)
+        return false;
+
+    // the new file takes over the permissions of the old one
+    if (!::stat(target.c_str(), &st))
+    {
+        ::fchmod(fd, st.st_mode & 07777);
+        if (::fchown(fd, st.st_uid, st.st_gid) < 0)
+            ::fchmod(fd, st.st_mode & 0777);
+    }
+    else
+        ::fchmod(fd, 0666 & ~file_mask);
+
+    SpanWriter writer(fd, buffer.source(), progress);
+
+    result = buffer.forEachSpan([&writer](const char *data, size_t length) {
+        return writer.add(data, length);
+    });
+    result = result && writer.add("\n", 1) && writer.flush();
+    result = result && !::fsync(fd);
+    result = !::close(fd) && result;
+    result = result && !::rename(tmpname.c_str(), target.c_str());
+
+    if (!result)
+    {
+        ::unlink(tmpname.c_str());
+        return false;
+    }
+
+    // make the rename itself durable
+    if (const int32_t dirfd = ::open(dirname.c_str(), O_RDONLY | O_DIRECTORY); dirfd >= 0)
+    {
+        ::fsync(dirfd);
+        ::close(dirfd);
+    }
+
+    return true;
+}
+
+//--- file job ---
+
+FileJob::FileJob()
+: _buffer(), _filename(), _thread(), _done(0), _total(0), _finished(false), _result(false),
+  _type(Type::none)
+{
+}
+
+FileJob::~FileJob() noexcept
+{
+    // a running save is never abandoned, the file would stay behind as a temporary one
+    if (_thread.joinable())
+        _thread.join();
+}
+
+bool FileJob::load(const std::string &filename)
+{
+    if (_type != Type::none)
+        return false;
+
+    _buffer.clear();
+    _total = 0;
+    start(Type::load, filename, [this]() {
+        if (!_buffer.load(_filename))
+            return false;
+
+        // indexing reads the whole file, which is what takes time on slow storage, the line feeds
+        // are counted on all cores and the pieces taken in order
+        IndexJob indexer;
+
+        _total = _buffer.unindexed();
+        indexer.start(_buffer);
+        while (const size_t rest = indexer.take(_buffer, true))
+            _done = _total - rest;
+
+        return true;
+    });
+
+    return true;
+}
+
+bool FileJob::save(const TextBuffer &buffer, const std::string &filename)
+{
+    if (_type != Type::none)
+        return false;
+
+    // the content is written as it was when saving started, later edits only change the original
+    _buffer = buffer;
+    _total = _buffer.size() + _buffer.unindexed() + 1;
+    start(Type::save, filename, [this]() {
+        return writeFile(_buffer, _filename, [this](size_t done) { _done = done; });
+    });
+
+    return true;
+}
+
+FileJob::Type FileJob::type() const
+{
+    return _type;
+}
+
+bool FileJob::done() const
+{
+    return _finished;
+}
+
+uint32_t FileJob::percent() const
+{
+    const size_t total = _total;
+
+    return total ? std::min<size_t>(_done * 100 / total, 100) : 0;
+}
+
+bool FileJob::finish(TextBuffer &buffer)
+{
+    if (_type == Type::none)
+        return false;
+
+    _thread.join();
+    if ((_type == Type::load) && _result)
+        buffer = std::move(_buffer);
+
+    // drops the snapshot, the memory of content replaced in the meantime is released here
+    _buffer.clear();
+    _type = Type::none;
+
+    return _result;
+}
+
+//--- private methods ---
+
+void FileJob::start(const Type type, const std::string &filename, std::function<bool()> &&work)
+{
+    _type = type;
+    _filename = filename;
+    _done = 0;
+    _finished = false;
+    _result = false;
+    _thread = std::thread([this, work = std::move(work)]() {
+        _result = work();
+        _finished = true;
+    });
+}
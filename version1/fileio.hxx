@@ -0,0 +1,80 @@
+#pragma once
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+#include "textbuffer.hxx"
+
+// called with the number of bytes processed so far
+using ProgressFunc = std::function<void(size_t done)>;
+
+// Saves the whole buffer content to filename. The content goes into a temporary file next to the
+// target first, memory spans are gathered into writev() batches and unmodified spans of the mapped
+// original are copied by the kernel. The temporary file is synced and renamed over the target, so
+// the target is either the old or the new file, never a half written one.
+bool writeFile(const TextBuffer &buffer, const std::string &filename,
+               const ProgressFunc &progress = nullptr);
+
+// Runs a load or a save on a worker thread, one at a time. A save writes a snapshot of the buffer,
+// so the editor keeps working on the buffer itself. A load maps and fully indexes a new buffer,
+// which replaces the edited one once the job is finished. The editor polls progress and completion.
+class FileJob {
+public:
+    //--- public types ---
+    enum class Type {
+        none,
+        load,
+        save
+    };
+
+    //--- public constructors ---
+    FileJob();
+    FileJob(const FileJob &rhs) = delete;
+    FileJob(FileJob &&rhs) = delete;
+    ~FileJob() noexcept;
+
+    //--- public operators ---
+    FileJob &operator=(const FileJob &rhs) = delete;
+    FileJob &operator=(FileJob &&rhs) = delete;
+
+    //--- public methods ---
+    bool load(const std::string &filename);
+    bool save(const TextBuffer &buffer, const std::string &filename);
+
+    Type type() const;
+    bool done() const;
+    uint32_t percent() const;
+    bool finish(TextBuffer &buffer);
+
+private:
+    //--- private methods ---
+    void start(const Type type, const std::string &filename, std::function<bool()> &&work);
+
+    //--- private properties ---
+    TextBuffer _buffer;
+    std::string _filename;
+    std::thread _thread;
+    std::atomic<size_t> _done;
+    std::atomic<size_t> _total;
+    std::atomic<bool> _finished;
+    bool _result;
+    Type _type;
+};
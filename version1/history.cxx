@@ -0,0 +1,189 @@
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "history.hxx"
+
+//--- public constructors ---
+
+History::History(const size_t limit)
+: _undo(), _redo(), _limit(limit), _memory(0), _sealed(true)
+{
+}
+
+//--- public methods ---
+
+void History::inserted(const TextBuffer &buffer, const size_t pos, const size_t length)
+{
+    if (!length)
+        return;
+
+    // typing right behind the last insert, the span is taken again from the buffer, it is one piece
+    // most of the time instead of one piece per key
+    if (!_sealed && !_undo.empty())
+    {
+        Record &last = _undo.back();
+
+        if (!last.removed.size() && !last.inserted.lines()
+            && (pos == (last.pos + last.inserted.size())))
+        {
+            last.inserted = buffer.slice(last.pos, last.inserted.size() + length);
+            update(last, last.inserted.memory());
+            dropRedo();
+            _sealed = last.inserted.lines() > 0;
+            trim();
+            return;
+        }
+    }
+
+    add({pos, TextBuffer::Span(), buffer.slice(pos, length), 0});
+}
+
+void History::erased(const TextBuffer &buffer, const size_t pos, TextBuffer::Span &&removed)
+{
+    if (!removed.size())
+        return;
+
+    // backspace erases in front of the last erase, delete at the same position
+    if (!_sealed && !_undo.empty())
+    {
+        Record &last = _undo.back();
+        const bool front = (pos + removed.size()) == last.pos;
+
+        if (!last.inserted.size() && !last.removed.lines() && (front || (pos == last.pos)))
+        {
+            last.removed = front ? buffer.concat(removed, last.removed)
+                                 : buffer.concat(last.removed, removed);
+            last.pos = pos;
+            update(last, last.removed.memory());
+            dropRedo();
+            _sealed = last.removed.lines() > 0;
+            trim();
+            return;
+        }
+    }
+
+    add({pos, std::move(removed), TextBuffer::Span(), 0});
+}
+
+void History::replaced(const TextBuffer &buffer, const size_t pos, TextBuffer::Span &&removed,
+                       const size_t length)
+{
+    if (!removed.size() && !length)
+        return;
+
+    // never extended, a replacement is a record of its own
+    add({pos, std::move(removed), buffer.slice(pos, length), 0});
+    _sealed = true;
+}
+
+void History::seal()
+{
+    _sealed = true;
+}
+
+void History::clear()
+{
+    _undo.clear();
+    _redo.clear();
+    _memory = 0;
+    _sealed = true;
+}
+
+void History::setLimit(const size_t limit)
+{
+    _limit = limit;
+    trim();
+}
+
+bool History::undo(TextBuffer &buffer, size_t &start, size_t &end)
+{
+    if (_undo.empty())
+        return false;
+
+    Record record = std::move(_undo.back());
+
+    _undo.pop_back();
+    buffer.erase(record.pos, record.inserted.size());
+    buffer.insert(record.pos, record.removed);
+    start = record.pos;
+    end = record.pos + record.removed.size();
+    _redo.push_back(std::move(record));
+    _sealed = true;
+
+    return true;
+}
+
+bool History::redo(TextBuffer &buffer, size_t &start, size_t &end)
+{
+    if (_redo.empty())
+        return false;
+
+    Record record = std::move(_redo.back());
+
+    _redo.pop_back();
+    buffer.erase(record.pos, record.removed.size());
+    buffer.insert(record.pos, record.inserted);
+    start = record.pos;
+    end = record.pos + record.inserted.size();
+    _undo.push_back(std::move(record));
+    _sealed = true;
+
+    return true;
+}
+
+size_t History::memory() const
+{
+    return _memory;
+}
+
+//--- private methods ---
+
+void History::add(Record &&record)
+{
+    dropRedo();
+    record.memory = sizeof (Record) + record.removed.memory() + record.inserted.memory();
+    _memory += record.memory;
+    _sealed = (record.removed.lines() + record.inserted.lines()) > 0;
+    _undo.push_back(std::move(record));
+    trim();
+}
+
+void History::dropRedo()
+{
+    // a new edit makes everything undone before unreachable
+    for (const Record &record : _redo)
+        _memory -= record.memory;
+    _redo.clear();
+}
+
+void History::update(Record &record, const size_t memory)
+{
+    _memory -= record.memory;
+    record.memory = sizeof (Record) + memory;
+    _memory += record.memory;
+}
+
+void History::trim()
+{
+    // the last record always stays, even when it alone is above the limit
+    while ((_memory > _limit) && (_undo.size() > 1))
+    {
+        _memory -= _undo.front().memory;
+        _undo.pop_front();
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <deque>
+#include <vector>
+#include "textbuffer.hxx"
+
+// Undo and redo of buffer edits. Every record replaces one span of the buffer by another at the same
+// position, both are kept as spans of the buffer instead of copies of the text, so undoing costs
+// time and memory by the size of the edit and not of the buffer. Typing and deleting at the same
+// place extend the last record until something else happens or a line feed ends it. The oldest
+// records are dropped when the records need more memory than the limit allows.
+class History {
+public:
+    //--- public constants ---
+    static constexpr size_t default_limit = 64 * 1024 * 1024;
+
+    //--- public constructors ---
+    History(const size_t limit = default_limit);
+    History(const History &rhs) = delete;
+    History(History &&rhs) = delete;
+    ~History() noexcept = default;
+
+    //--- public operators ---
+    History &operator=(const History &rhs) = delete;
+    History &operator=(History &&rhs) = delete;
+
+    //--- public methods ---
+    void inserted(const TextBuffer &buffer, const size_t pos, const size_t length);
+    void erased(const TextBuffer &buffer, const size_t pos, TextBuffer::Span &&removed);
+    void replaced(const TextBuffer &buffer, const size_t pos, TextBuffer::Span &&removed,
+                  const size_t length);
+    void seal();
+    void clear();
+    void setLimit(const size_t limit);
+
+    bool undo(TextBuffer &buffer, size_t &start, size_t &end);
+    bool redo(TextBuffer &buffer, size_t &start, size_t &end);
+
+    size_t memory() const;
+
+private:
+    //--- private types ---
+    struct Record {
+        size_t pos;
+        TextBuffer::Span removed;
+        TextBuffer::Span inserted;
+        size_t memory;
+    };
+
+    //--- private methods ---
+    void add(Record &&record);
+    void dropRedo();
+    void update(Record &record, const size_t memory);
+    void trim();
+
+    //--- private properties ---
+    std::deque<Record> _undo;
+    std::vector<Record> _redo;
+    size_t _limit;
+    size_t _memory;
+    bool _sealed;
+};
@@ -0,0 +1,145 @@
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include "linescan.h"
+#include "indexer.hxx"
+
+//--- public constructors ---
+
+IndexJob::IndexJob()
+: _buffer(), _data(nullptr), _size(0), _counts(), _chunks(), _threads(), _mutex(), _counted(),
+  _next(0), _stop(false)
+{
+}
+
+IndexJob::~IndexJob() noexcept
+{
+    cancel();
+}
+
+//--- public methods ---
+
+void IndexJob::start(const TextBuffer &buffer)
+{
+    constexpr size_t chunk_pieces = chunk_size / TextBuffer::max_piece;
+
+    cancel();
+    _data = buffer.tail();
+    _size = buffer.unindexed();
+    _next = 0;
+    _stop = false;
+
+    // a tail of a single chunk is indexed by the buffer on its own
+    if (_size <= chunk_size)
+        return;
+
+    const size_t pieces = (_size + TextBuffer::max_piece - 1) / TextBuffer::max_piece;
+
+    _buffer = buffer;
+    _counts.resize(pieces);
+    for (size_t piece = 0; piece < pieces; piece += chunk_pieces)
+        _chunks.push_back({piece, std::min(chunk_pieces, pieces - piece), false});
+
+    const size_t workers = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u),
+                                            _chunks.size());
+
+    for (size_t i = 0; i < workers; ++i)
+        _threads.emplace_back([this]() { work(); });
+}
+
+void IndexJob::cancel()
+{
+    _stop = true;
+    for (auto &thread : _threads)
+        thread.join();
+    _threads.clear();
+    _chunks.clear();
+    _counts.clear();
+    _counts.shrink_to_fit();
+
+    // nothing reads the snapshot anymore, its mapping is only kept by the buffers using it
+    _buffer.clear();
+}
+
+bool IndexJob::active() const
+{
+    return !_threads.empty();
+}
+
+size_t IndexJob::take(TextBuffer &buffer, const bool wait)
+{
+    if (_threads.empty())
+        return buffer.index(TextBuffer::index_step);
+
+    // the counts are only valid for the counted tail or a suffix of it which starts with a piece
+    const uintptr_t data = reinterpret_cast<uintptr_t>(_data);
+    const uintptr_t tail = reinterpret_cast<uintptr_t>(buffer.tail());
+    const size_t offset = tail - data;
+
+    if ((tail < data) || (offset >= _size) || (offset % TextBuffer::max_piece)
+        || ((offset + buffer.unindexed()) != _size))
+    {
+        cancel();
+        return buffer.index(TextBuffer::index_step);
+    }
+
+    const size_t piece = offset / TextBuffer::max_piece;
+    size_t chunk = piece / (chunk_size / TextBuffer::max_piece);
+    size_t pieces = 0;
+
+    // every chunk done without a gap is taken at once, waiting only for the first one
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        if (wait)
+            _counted.wait(lock, [this, chunk]() { return _chunks[chunk].done; });
+        for (; (chunk < _chunks.size()) && _chunks[chunk].done; ++chunk)
+            pieces = _chunks[chunk].piece + _chunks[chunk].pieces - piece;
+    }
+
+    if (pieces)
+        buffer.indexCounted(_counts.data() + piece, pieces);
+    if (!buffer.unindexed())
+        cancel();
+
+    return buffer.unindexed();
+}
+
+//--- private methods ---
+
+void IndexJob::work()
+{
+    for (size_t next = _next++; !_stop && (next < _chunks.size()); next = _next++)
+    {
+        Chunk &chunk = _chunks[next];
+
+        for (size_t piece = chunk.piece; !_stop && (piece < (chunk.piece + chunk.pieces)); ++piece)
+        {
+            const size_t pos = piece * TextBuffer::max_piece;
+
+            _counts[piece] = ::linescan_count(_data + pos, std::min(TextBuffer::max_piece,
+                                                                    _size - pos));
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        chunk.done = !_stop;
+        _counted.notify_all();
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "textbuffer.hxx"
+
+// Counts the line feeds of the unindexed tail of a buffer on a pool of worker threads. The tail is
+// split into chunks of whole pieces, the workers take them from the front to the back and count
+// every piece of a chunk on its own. The counted pieces are handed to the buffer in order, as far
+// as the chunks are done without a gap, so the indexed part grows from the front while the workers
+// are ahead of it. The workers read a snapshot of the buffer, edits in the meantime only matter
+// once they move the tail away from the counted one, the job is given up then.
+class IndexJob {
+public:
+    //--- public constants ---
+    static constexpr size_t chunk_size = TextBuffer::index_step;
+
+    //--- public constructors ---
+    IndexJob();
+    IndexJob(const IndexJob &rhs) = delete;
+    IndexJob(IndexJob &&rhs) = delete;
+    ~IndexJob() noexcept;
+
+    //--- public operators ---
+    IndexJob &operator=(const IndexJob &rhs) = delete;
+    IndexJob &operator=(IndexJob &&rhs) = delete;
+
+    //--- public methods ---
+    void start(const TextBuffer &buffer);
+    void cancel();
+
+    bool active() const;
+    size_t take(TextBuffer &buffer, const bool wait = false);
+
+private:
+    //--- private types ---
+    struct Chunk {
+        size_t piece;
+        size_t pieces;
+        bool done;
+    };
+
+    //--- private methods ---
+    void work();
+
+    //--- private properties ---
+    TextBuffer _buffer;
+    const char *_data;
+    size_t _size;
+    std::vector<uint32_t> _counts;
+    std::vector<Chunk> _chunks;
+    std::vector<std::thread> _threads;
+    std::mutex _mutex;
+    std::condition_variable _counted;
+    std::atomic<size_t> _next;
+    std::atomic<bool> _stop;
+};
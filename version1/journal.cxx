@@ -0,0 +1,437 @@
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "journal.hxx"
+
+// every record starts with the length of its content and the checksum of it
+const size_t frame_size = sizeof (uint64_t) + sizeof (uint32_t);
+const char magic[] = "watte journal 1\n";
+const size_t header_size = sizeof (magic) - 1 + 3 * sizeof (uint64_t);
+
+static void putNumber(std::string &out, uint64_t value)
+{
+    // 7 bits per byte, the top bit tells that more bytes follow
+    while (value >= 0x80)
+    {
+        out += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+static bool getNumber(const char *&data, const char *end, uint64_t &value)
+{
+    value = 0;
+    for (uint32_t shift = 0; (data < end) && (shift < 64); shift += 7)
+    {
+        const uint8_t byte = *data++;
+
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+
+    return false;
+}
+
+static uint32_t checksum(const char *data, const size_t length)
+{
+    uint32_t hash = 2166136261u;
+
+    for (size_t i = 0; i < length; ++i)
+    {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static std::string startRecord(const uint64_t count, const size_t length)
+{
+    std::string record(frame_size, '\0');
+
+    record.reserve(frame_size + 20 + length);
+    putNumber(record, count);
+    putNumber(record, length);
+
+    return record;
+}
+
+static void endRecord(std::string &record)
+{
+    // the checksum is filled in by the writing thread
+    const uint64_t length = record.size() - frame_size;
+
+    std::memcpy(record.data(), &length, sizeof (length));
+}
+
+static bool writeAll(const int32_t fd, const char *data, size_t length)
+{
+    while (length)
+    {
+        const ssize_t written = ::write(fd, data, length);
+
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        data += written;
+        length -= written;
+    }
+
+    return true;
+}
+
+//--- public constructors ---
+
+Journal::Journal()
+: _filename(), _path(), _header(), _pending(), _marked(), _thread(), _mutex(), _wake(), _fd(-1),
+  _marking(false), _truncate(false), _stop(false), _disabled(false), _replaying(false)
+{
+}
+
+Journal::~Journal() noexcept
+{
+    if (_thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+
+            _stop = true;
+        }
+        _wake.notify_one();
+        _thread.join();
+    }
+
+    // a buffer closed on purpose leaves nothing to recover
+    if (_fd >= 0)
+    {
+        ::unlink(_path.c_str());
+        ::close(_fd);
+    }
+}
+
+//--- public methods ---
+
+size_t Journal::open(const std::string &filename, const EditFunc &replay)
+{
+    char *resolved = ::realpath(filename.c_str(), nullptr);
+    const std::string target = resolved ? resolved : filename;
+    const size_t slash = target.rfind('/');
+    std::string content;
+    size_t valid = 0;
+    size_t count = 0;
+    char chunk[64 * 1024];
+    ssize_t length;
+
+    std::free(resolved);
+    _filename = filename;
+    _path = (slash == std::string::npos) ? ("." + target + ".journal")
+            : (target.substr(0, slash + 1) + "." + target.substr(slash + 1) + ".journal");
+    _header = header();
+
+    const int32_t fd = ::open(_path.c_str(), O_RDWR | O_APPEND | O_CLOEXEC);
+
+    if (fd < 0)
+        return 0;
+
+    // the journal belongs to another editor of the same file
+    if (::flock(fd, LOCK_EX | LOCK_NB) < 0)
+    {
+        ::close(fd);
+        _disabled = true;
+        return 0;
+    }
+
+    while (((length = ::read(fd, chunk, sizeof (chunk))) > 0) || ((length < 0) && (errno == EINTR)))
+        content.append(chunk, std::max<ssize_t>(length, 0));
+
+    // the records are replayed up to the first one cut off or damaged, a journal of another version
+    // of the file is not replayed at all
+    if (!content.compare(0, _header.size(), _header))
+    {
+        valid = _header.size();
+        _replaying = true;
+        while ((content.size() - valid) >= frame_size)
+        {
+            const char *data = content.data() + valid + frame_size;
+            std::vector<TextBuffer::Range> ranges;
+            uint64_t size;
+            uint32_t sum;
+            uint64_t ranges_count;
+            uint64_t text_size;
+            uint64_t end = 0;
+
+            std::memcpy(&size, content.data() + valid, sizeof (size));
+            std::memcpy(&sum, content.data() + valid + sizeof (size), sizeof (sum));
+            if ((size > (content.size() - valid - frame_size)) || (checksum(data, size) != sum))
+                break;
+
+            const char *limit = data + size;
+
+            if (!getNumber(data, limit, ranges_count) || !getNumber(data, limit, text_size)
+                || (text_size > static_cast<uint64_t>(limit - data)))
+                break;
+
+            const std::string text(data, text_size);
+
+            data += text_size;
+            for (uint64_t i = 0; i < ranges_count; ++i)
+            {
+                uint64_t gap;
+                uint64_t range;
+
+                if (!getNumber(data, limit, gap) || !getNumber(data, limit, range))
+                    break;
+                ranges.push_back({end + gap, range});
+                end += gap + range;
+            }
+            if ((ranges.size() != ranges_count) || (data != limit) || !replay(ranges, text))
+                break;
+
+            valid += frame_size + size;
+            ++count;
+        }
+        _replaying = false;
+    }
+
+    _fd = fd;
+    if (!valid)
+    {
+        _pending = _header;
+        _truncate = true;
+    }
+    else if ((valid < content.size()) && (::ftruncate(fd, valid) < 0))
+        _disabled = true;
+    _thread = std::thread(&Journal::work, this);
+
+    return count;
+}
+
+void Journal::replaced(const TextBuffer &buffer, const size_t pos, const size_t removed,
+                       const size_t length)
+{
+    if ((!removed && !length) || _disabled || _replaying || ((_fd < 0) && !create()))
+        return;
+
+    std::string record = startRecord(1, length);
+
+    buffer.forEachSpan(pos, length, [&record](const char *data, size_t count) {
+        record.append(data, count);
+        return true;
+    });
+    putNumber(record, pos);
+    putNumber(record, removed);
+    endRecord(record);
+    append(std::move(record));
+}
+
+void Journal::replaced(const std::vector<TextBuffer::Range> &ranges, const std::string &text)
+{
+    size_t end = 0;
+
+    if (ranges.empty() || _disabled || _replaying || ((_fd < 0) && !create()))
+        return;
+
+    // positions are stored as the distance from the end of the range before
+    std::string record = startRecord(ranges.size(), text.size());
+
+    record += text;
+    for (const TextBuffer::Range &range : ranges)
+    {
+        putNumber(record, range.pos - end);
+        putNumber(record, range.length);
+        end = range.pos + range.length;
+    }
+    endRecord(record);
+    append(std::move(record));
+}
+
+void Journal::mark()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    // the records from now on are not part of the saved file
+    _marking = true;
+    _marked.clear();
+}
+
+void Journal::saved(const bool result)
+{
+    std::string marked;
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        _marking = false;
+        marked.swap(_marked);
+    }
+    if (result)
+        restart(std::move(marked));
+}
+
+void Journal::reset()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        _marking = false;
+        _marked.clear();
+    }
+    restart(std::string());
+}
+
+//--- private methods ---
+
+std::string Journal::header() const
+{
+    uint64_t base[3] = {0, 0, 0};
+    struct stat st;
+
+    if (!::stat(_filename.c_str(), &st))
+    {
+        base[0] = st.st_size;
+        base[1] = st.st_ino;
+        base[2] = st.st_mtime;
+    }
+
+    return std::string(magic) + std::string(reinterpret_cast<const char *>(base), sizeof (base));
+}
+
+bool Journal::create()
+{
+    const int32_t fd = ::open(_path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0600);
+
+    if ((fd < 0) || (::flock(fd, LOCK_EX | LOCK_NB) < 0))
+    {
+        if (fd >= 0)
+            ::close(fd);
+        _disabled = true;
+        return false;
+    }
+
+    // a journal left behind which was not replayed is written anew
+    _fd = fd;
+    _pending = _header;
+    _truncate = true;
+    _thread = std::thread(&Journal::work, this);
+
+    return true;
+}
+
+void Journal::append(std::string &&record)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    const bool idle = _pending.empty();
+
+    if (_marking)
+        _marked += record;
+    if (idle)
+        _pending = std::move(record);
+    else
+        _pending += record;
+
+    // the writer starts collecting with the first record, a large batch is written right away
+    if (idle || (_pending.size() >= write_size))
+        _wake.notify_one();
+}
+
+void Journal::restart(std::string &&records)
+{
+    // the file on disk is what the journal applies to from now on
+    _header = header();
+    if (_fd < 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    _pending = _header + records;
+    _truncate = true;
+    _wake.notify_one();
+}
+
+void Journal::work()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    std::chrono::steady_clock::time_point synced = std::chrono::steady_clock::now();
+    bool unsynced = false;
+
+    while (true)
+    {
+        const auto ready = [this]() { return _stop || !_pending.empty(); };
+
+        // idle until there is something to write, written records are synced once the interval is
+        // over, records following shortly after the first one are written together with it
+        if (unsynced)
+            _wake.wait_until(lock, synced + sync_interval, ready);
+        else
+            _wake.wait(lock, ready);
+        if (!_stop && !_pending.empty() && (_pending.size() < write_size))
+            _wake.wait_for(lock, write_interval, [this]() {
+                return _stop || (_pending.size() >= write_size);
+            });
+        if (_stop)
+            return;
+
+        std::string batch = std::move(_pending);
+        const bool truncate = _truncate;
+
+        _pending.clear();
+        _truncate = false;
+        lock.unlock();
+
+        // a new start of the journal comes with its header in front of the records
+        for (size_t offset = truncate ? header_size : 0; (offset + frame_size) <= batch.size();)
+        {
+            uint64_t size;
+            uint32_t sum;
+
+            std::memcpy(&size, batch.data() + offset, sizeof (size));
+            sum = checksum(batch.data() + offset + frame_size, size);
+            std::memcpy(batch.data() + offset + sizeof (size), &sum, sizeof (sum));
+            offset += frame_size + size;
+        }
+
+        if (truncate && (::ftruncate(_fd, 0) < 0))
+            batch.clear();
+        if (!batch.empty() && writeAll(_fd, batch.data(), batch.size()))
+            unsynced = true;
+
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+        if (unsynced && ((now - synced) >= sync_interval))
+        {
+            ::fsync(_fd);
+            synced = now;
+            unsynced = false;
+        }
+        lock.lock();
+    }
+}
@@ -0,0 +1,94 @@
+#pragma once
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "textbuffer.hxx"
+
+// An append-only log of the edits of a buffer since its file was loaded or saved, kept next to
+// the file as .<name>.journal. Every edit is one record of the ranges it replaced and the text
+// replacing them, so a record costs what the edit costs and never a dump of the buffer. The editor
+// only encodes records into memory, a thread of the journal writes them in batches and syncs the
+// file at intervals. Every record carries its length and a checksum, a record cut off by a crash
+// ends the journal. The journal starts with the size, inode and modification time of the file it
+// applies to and is only replayed on that very file.
+//
+// Closing the buffer removes the journal, a journal left behind by a crash is replayed when the
+// file is opened the next time. After a save only the edits made while saving stay in the journal.
+// The journal is locked, a second buffer or editor of the same file does not keep one.
+class Journal {
+public:
+    //--- public types ---
+    using EditFunc = std::function<bool(const std::vector<TextBuffer::Range> &ranges,
+                                        const std::string &text)>;
+
+    //--- public constants ---
+    static constexpr std::chrono::milliseconds write_interval{100};
+    static constexpr std::chrono::milliseconds sync_interval{1000};
+    static constexpr size_t write_size = 1024 * 1024;
+
+    //--- public constructors ---
+    Journal();
+    Journal(const Journal &rhs) = delete;
+    Journal(Journal &&rhs) = delete;
+    ~Journal() noexcept;
+
+    //--- public operators ---
+    Journal &operator=(const Journal &rhs) = delete;
+    Journal &operator=(Journal &&rhs) = delete;
+
+    //--- public methods ---
+    size_t open(const std::string &filename, const EditFunc &replay);
+    void replaced(const TextBuffer &buffer, const size_t pos, const size_t removed,
+                  const size_t length);
+    void replaced(const std::vector<TextBuffer::Range> &ranges, const std::string &text);
+    void mark();
+    void saved(const bool result);
+    void reset();
+
+private:
+    //--- private methods ---
+    std::string header() const;
+    bool create();
+    void append(std::string &&record);
+    void restart(std::string &&records);
+    void work();
+
+    //--- private properties ---
+    std::string _filename;
+    std::string _path;
+    std::string _header;
+    std::string _pending;
+    std::string _marked;
+    std::thread _thread;
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    int32_t _fd;
+    bool _marking;
+    bool _truncate;
+    bool _stop;
+    bool _disabled;
+    bool _replaying;
+};
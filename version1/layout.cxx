@@ -0,0 +1,556 @@
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cwchar>
+#include <iterator>
+#include "layout.hxx"
+
+// length of the UTF-8 sequence at data and its code point, -1 for a byte which starts no valid
+// sequence, 0 when the sequence continues behind length
+static size_t decode(const char *data, const size_t length, int32_t &code)
+{
+    const uint8_t lead = data[0];
+    int32_t min;
+    size_t size;
+
+    if (lead < 0x80)
+    {
+        code = lead;
+        return 1;
+    }
+
+    if ((lead & 0xe0) == 0xc0)
+    {
+        size = 2;
+        code = lead & 0x1f;
+        min = 0x80;
+    }
+    else if ((lead & 0xf0) == 0xe0)
+    {
+        size = 3;
+        code = lead & 0x0f;
+        min = 0x800;
+    }
+    else if ((lead & 0xf8) == 0xf0)
+    {
+        size = 4;
+        code = lead & 0x07;
+        min = 0x10000;
+    }
+    else
+    {
+        code = -1;
+        return 1;
+    }
+
+    for (size_t i = 1; i < size; ++i)
+    {
+        if (i >= length)
+            return 0;
+        if ((static_cast<uint8_t>(data[i]) & 0xc0) != 0x80)
+        {
+            code = -1;
+            return 1;
+        }
+        code = (code << 6) | (data[i] & 0x3f);
+    }
+
+    // overlong forms, surrogates and everything beyond unicode
+    if ((code < min) || (code > 0x10ffff) || ((code >= 0xd800) && (code <= 0xdfff)))
+    {
+        code = -1;
+        return 1;
+    }
+
+    return size;
+}
+
+static bool isPlain(const char chr)
+{
+    return (chr >= 0x20) && (chr < 0x7f);
+}
+
+static int32_t widthOf(const int32_t code)
+{
+    return (code >= 0) ? ::wcwidth(code) : -1;
+}
+
+//--- public methods ---
+
+void LineLayout::build(const TextBuffer &buffer, const size_t line, const int32_t first,
+                       const int32_t columns)
+{
+    const size_t length = buffer.lineLength(line);
+
+    if ((length == _length) && (first == _first) && (columns == _columns))
+        return;
+
+    // edits update the length, a line still growing by indexing only gets longer and a character
+    // cut at its old end may be complete now
+    if (length != _length)
+    {
+        while ((_marks.size() > 1) && ((_marks.back().offset + 4) > _length))
+            _marks.pop_back();
+        _width = -1;
+    }
+
+    _buffer = &buffer;
+    _line = line;
+    _length = length;
+    _first = first;
+    _columns = columns;
+    _cells.clear();
+
+    const int64_t last = static_cast<int64_t>(first) + columns;
+    const auto mark = std::upper_bound(_marks.begin(), _marks.end(), first,
+                                       [](const int32_t value, const Mark &mark) {
+        return value < mark.column;
+    }) - 1;
+
+    // runs cut by the edges are shortened, a wide character cut by them is left out
+    scanMarked(*mark, [&](const Cell &cell) {
+        Cell part = cell;
+
+        if ((part.column + part.width) <= first)
+            return true;
+        if (part.column < first)
+        {
+            if (part.kind != Kind::run)
+                return true;
+            part.offset += first - part.column;
+            part.size -= first - part.column;
+            part.width -= first - part.column;
+            part.column = first;
+        }
+        if ((part.column + part.width) > last)
+        {
+            if ((part.kind == Kind::run) && (part.column < last))
+            {
+                part.size = last - part.column;
+                part.width = last - part.column;
+                _cells.push_back(part);
+            }
+            return false;
+        }
+        _cells.push_back(part);
+
+        return true;
+    });
+}
+
+void LineLayout::edited(const size_t offset, const size_t removed, const size_t inserted)
+{
+    // marks in front of the edit keep their column, marks inside of it are gone and the ones
+    // behind it move with their text, the first mark is the start of the line and always stays
+    const auto behind = std::lower_bound(_marks.begin() + 1, _marks.end(), offset,
+                                         [](const Mark &mark, const size_t value) {
+        return mark.offset < value;
+    });
+    const auto moved = std::lower_bound(behind, _marks.end(), offset + removed,
+                                        [](const Mark &mark, const size_t value) {
+        return mark.offset < value;
+    });
+    const size_t from = std::distance(_marks.begin(), behind) - 1;
+
+    for (auto mark = _marks.erase(behind, moved); mark != _marks.end(); ++mark)
+        mark->offset = mark->offset + inserted - removed;
+    _length = _length + inserted - removed;
+    _columns = -1;
+    _width = -1;
+    _cells.clear();
+    resync(from);
+}
+
+std::string LineLayout::render(const int32_t first, const int32_t columns) const
+{
+    const int64_t last = static_cast<int64_t>(first) + columns;
+    const auto begin = std::upper_bound(_cells.begin(), _cells.end(), first,
+                                        [](const int32_t value, const Cell &cell) {
+        return value < (cell.column + cell.width);
+    });
+    const auto end = std::lower_bound(begin, _cells.end(), last,
+                                      [](const Cell &cell, const int64_t value) {
+        return cell.column < value;
+    });
+    std::string text;
+    int32_t used = 0;
+
+    // the columns of the window from first on, runs cut by the edges are shortened, a wide
+    // character cut by them leaves its visible part blank, columns without cells are blank
+    if (begin != end)
+    {
+        const size_t offset = begin->offset;
+        const std::string bytes = _buffer->text(_buffer->lineStart(_line) + offset,
+                                                (end - 1)->offset + (end - 1)->size - offset);
+
+        for (auto cell = begin; cell != end; ++cell)
+        {
+            const int32_t skip = std::max(first - cell->column, 0);
+            const int32_t width = std::min<int64_t>(cell->column + cell->width, last)
+                                  - cell->column - skip;
+            const char *data = bytes.data() + (cell->offset - offset);
+            const int32_t column = std::max(cell->column, first) - first;
+
+            text.append(column - used, ' ');
+            used = column + width;
+            switch (cell->kind)
+            {
+                case Kind::run:
+                    text.append(data + skip, width);
+                    break;
+
+                case Kind::text:
+                    if (width == cell->width)
+                        text.append(data, cell->size);
+                    else
+                        text.append(width, ' ');
+                    break;
+
+                case Kind::tab:
+                    text.append(width, ' ');
+                    break;
+
+                case Kind::invalid:
+                    text.append(width, '?');
+                    break;
+            }
+        }
+    }
+    text.append(columns - used, ' ');
+
+    return text;
+}
+
+int32_t LineLayout::first() const
+{
+    return _first;
+}
+
+int32_t LineLayout::width()
+{
+    if (_width < 0)
+        _width = columnOf(_length);
+
+    return _width;
+}
+
+int32_t LineLayout::columnOf(const size_t offset)
+{
+    const Cell cell = cellAt(offset);
+
+    return (cell.kind == Kind::run) ? (cell.column + (offset - cell.offset)) : cell.column;
+}
+
+size_t LineLayout::offsetOf(const int32_t column)
+{
+    const Cell cell = cellAtColumn(column);
+
+    return (cell.kind == Kind::run) ? (cell.offset + (column - cell.column)) : cell.offset;
+}
+
+size_t LineLayout::next(const size_t offset)
+{
+    const Cell cell = cellAt(offset);
+
+    return (cell.kind == Kind::run) ? (offset + 1) : (cell.offset + cell.size);
+}
+
+size_t LineLayout::previous(const size_t offset)
+{
+    if (!offset)
+        return 0;
+
+    const size_t last = std::min(offset, _length) - 1;
+    const Cell cell = cellAt(last);
+
+    return (cell.kind == Kind::run) ? last : cell.offset;
+}
+
+//--- private methods ---
+
+bool LineLayout::scan(const size_t offset, const int32_t column, const CellFunc &func) const
+{
+    const size_t start = _buffer->lineStart(_line);
+    Cell cell = {offset, column, 0, 0, Kind::text};
+    size_t pos = offset;
+    size_t skip = 0;
+    bool stopped = false;
+
+    // a cell is passed on once the next character shows that nothing joins it anymore
+    const auto flush = [&]() {
+        stopped = cell.size && !func(cell);
+        return !stopped;
+    };
+
+    // a character cut by the end of a span is read as a whole and its rest is skipped in the next
+    // span
+    _buffer->forEachSpan(start + offset, _length - offset, [&](const char *data, size_t count) {
+        size_t i = std::min(skip, count);
+
+        skip -= i;
+        while (i < count)
+        {
+            if (isPlain(data[i]))
+            {
+                // runs end at the distance of marks, a mark can be put at every cell
+                if ((cell.kind != Kind::run) || (cell.size >= mark_distance))
+                {
+                    if (!flush())
+                        return false;
+                    cell = {pos, cell.column + cell.width, 0, 0, Kind::run};
+                }
+
+                const size_t end = i + std::min(count - i, mark_distance - cell.size);
+                size_t run = i;
+
+                while ((run < end) && isPlain(data[run]))
+                    ++run;
+                cell.size += run - i;
+                cell.width += run - i;
+                pos += run - i;
+                i = run;
+                continue;
+            }
+
+            int32_t code;
+            size_t size = decode(data + i, count - i, code);
+
+            if (!size)
+            {
+                const std::string whole = _buffer->text(start + pos, std::min<size_t>(_length - pos, 4));
+
+                size = decode(whole.data(), whole.size(), code);
+                if (!size)
+                {
+                    size = 1;
+                    code = -1;
+                }
+            }
+
+            const int32_t next = cell.column + cell.width;
+            const int32_t width = (code == '\t') ? (tab_width - (next % tab_width)) : widthOf(code);
+
+            if (!width && cell.size)
+            {
+                // the last character of a run becomes a cell of its own to take the joined one
+                if (cell.kind == Kind::run)
+                {
+                    if (cell.size > 1)
+                    {
+                        --cell.size;
+                        --cell.width;
+                        if (!flush())
+                            return false;
+                        cell = {pos - 1, next - 1, 1, 1, Kind::text};
+                    }
+                    else
+                        cell.kind = Kind::text;
+                }
+                cell.size += size;
+            }
+            else
+            {
+                if (!flush())
+                    return false;
+                cell = {pos, next, static_cast<uint32_t>(size), std::max(width, 1),
+                        (code == '\t') ? Kind::tab : (width > 0) ? Kind::text : Kind::invalid};
+            }
+
+            pos += size;
+            if ((i + size) > count)
+            {
+                skip = i + size - count;
+                return true;
+            }
+            i += size;
+        }
+
+        return true;
+    });
+
+    return !stopped && flush();
+}
+
+bool LineLayout::scanMarked(const Mark mark, const CellFunc &func)
+{
+    // scanning behind the last mark puts new marks and takes note of the tabs
+    return scan(mark.offset, mark.column, [&](const Cell &cell) {
+        if (cell.offset >= _marks.back().offset)
+        {
+            if (cell.offset >= (_marks.back().offset + mark_distance))
+                _marks.push_back({cell.offset, cell.column, false});
+            if (cell.kind == Kind::tab)
+                _marks.back().tabs = true;
+        }
+        return func(cell);
+    });
+}
+
+LineLayout::Cell LineLayout::cellAt(const size_t offset)
+{
+    // the window has the cells around the cursor, everything else is scanned from a mark
+    if (!_cells.empty() && (offset >= _cells.front().offset)
+        && (offset < (_cells.back().offset + _cells.back().size)))
+        return *(std::upper_bound(_cells.begin(), _cells.end(), offset,
+                                  [](const size_t value, const Cell &cell) {
+            return value < cell.offset;
+        }) - 1);
+
+    const auto mark = std::upper_bound(_marks.begin(), _marks.end(), offset,
+                                       [](const size_t value, const Mark &mark) {
+        return value < mark.offset;
+    }) - 1;
+    Cell found = {_length, mark->column, 0, 0, Kind::text};
+
+    // behind the end of the line is an empty cell at its last column
+    scanMarked(*mark, [&](const Cell &cell) {
+        if (offset < (cell.offset + cell.size))
+        {
+            found = cell;
+            return false;
+        }
+        found.column = cell.column + cell.width;
+        return true;
+    });
+
+    return found;
+}
+
+LineLayout::Cell LineLayout::cellAtColumn(const int32_t column)
+{
+    if (!_cells.empty() && (column >= _cells.front().column)
+        && (column < (_cells.back().column + _cells.back().width)))
+        return *(std::upper_bound(_cells.begin(), _cells.end(), column,
+                                  [](const int32_t value, const Cell &cell) {
+            return value < cell.column;
+        }) - 1);
+
+    const auto mark = std::upper_bound(_marks.begin(), _marks.end(), column,
+                                       [](const int32_t value, const Mark &mark) {
+        return value < mark.column;
+    }) - 1;
+    Cell found = {_length, mark->column, 0, 0, Kind::text};
+
+    scanMarked(*mark, [&](const Cell &cell) {
+        if (column < (cell.column + cell.width))
+        {
+            found = cell;
+            return false;
+        }
+        found.column = cell.column + cell.width;
+        return true;
+    });
+
+    return found;
+}
+
+void LineLayout::resync(size_t from)
+{
+    while ((from + 1) < _marks.size())
+    {
+        size_t next = from + 1;
+        int32_t column = -1;
+        bool tabs = false;
+
+        // the first moved mark still at the start of a cell gets its new column, the ones passed
+        // on the way are dropped
+        scan(_marks[from].offset, _marks[from].column, [&](const Cell &cell) {
+            while ((next < _marks.size()) && (_marks[next].offset < cell.offset))
+                ++next;
+            if ((next < _marks.size()) && (_marks[next].offset == cell.offset))
+            {
+                column = cell.column;
+                return false;
+            }
+            tabs |= cell.kind == Kind::tab;
+            return next < _marks.size();
+        });
+        _marks[from].tabs = tabs;
+        _marks.erase(_marks.begin() + from + 1, _marks.begin() + next);
+        if (column < 0)
+        {
+            _marks.resize(from + 1);
+            return;
+        }
+
+        // everything behind moves by the same number of columns, until a tab meets a shift which
+        // is no multiple of the tab width, the part up to the next mark is scanned again then
+        const int32_t shift = column - _marks[from + 1].column;
+
+        _marks[++from].column = column;
+        while (((from + 1) < _marks.size()) && (!(shift % tab_width) || !_marks[from].tabs))
+            _marks[++from].column += shift;
+    }
+}
+
+//--- layout cache ---
+
+LayoutCache::LayoutCache()
+: _layouts()
+{
+}
+
+LineLayout &LayoutCache::get(const TextBuffer &buffer, const size_t line, const int32_t first,
+                             const int32_t columns)
+{
+    auto layout = _layouts.find(line);
+
+    // lines far away from the one looked at go first, the ones around keep their marks
+    if (layout == _layouts.end())
+    {
+        if (_layouts.size() >= max_lines)
+            for (auto other = _layouts.begin(); other != _layouts.end();)
+            {
+                if (((other->first > line) ? (other->first - line) : (line - other->first))
+                    > (max_lines / 4))
+                    other = _layouts.erase(other);
+                else
+                    ++other;
+            }
+        layout = _layouts.emplace(line, LineLayout()).first;
+    }
+    layout->second.build(buffer, line, first, columns);
+
+    return layout->second;
+}
+
+void LayoutCache::edited(const size_t line, const size_t offset, const size_t removed,
+                         const size_t inserted)
+{
+    if (const auto layout = _layouts.find(line); layout != _layouts.end())
+        layout->second.edited(offset, removed, inserted);
+}
+
+void LayoutCache::invalidate(const size_t first, const size_t last)
+{
+    if ((last - first) <= _layouts.size())
+    {
+        for (size_t line = first; line < last; ++line)
+            _layouts.erase(line);
+        return;
+    }
+
+    for (auto layout = _layouts.begin(); layout != _layouts.end();)
+    {
+        if ((layout->first >= first) && (layout->first < last))
+            layout = _layouts.erase(layout);
+        else
+            ++layout;
+    }
+}
@@ -0,0 +1,132 @@
+#pragma once
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "textbuffer.hxx"
+
+// Where the bytes of a line end up on the screen. UTF-8 is decoded into characters taking the display
+// width of their code point, characters without width are joined with the character in front of
+// them and tabs reach up to the next tab stop. Bytes which are no valid UTF-8, control characters and
+// characters without width at the start of a line take one column and are shown as '?'.
+//
+// A layout is a window of the line, the cells of the columns from a first one on, and it knows the
+// columns of the whole line by marks: the column of a character every few kilobytes, taken while
+// scanning the line. Finding a column or an offset anywhere in the line scans from the closest mark,
+// so a window deep into a very long line costs as much as the window and the distance to a mark. An
+// edit keeps the marks in front of it and moves the ones behind it, only the edited part is scanned
+// again. Runs of plain ASCII are kept as one cell, so cells cost memory for the other characters.
+// The width of the whole line is kept as well, wrapped lines take their number of rows from it and
+// render each row from a part of the window.
+class LineLayout {
+public:
+    //--- public constants ---
+    static constexpr int32_t tab_width = 8;
+    static constexpr size_t mark_distance = 16 * 1024;
+
+    //--- public methods ---
+    void build(const TextBuffer &buffer, const size_t line, const int32_t first,
+               const int32_t columns);
+    void edited(const size_t offset, const size_t removed, const size_t inserted);
+    std::string render(const int32_t first, const int32_t columns) const;
+
+    int32_t first() const;
+    int32_t width();
+    int32_t columnOf(const size_t offset);
+    size_t offsetOf(const int32_t column);
+    size_t next(const size_t offset);
+    size_t previous(const size_t offset);
+
+private:
+    //--- private types ---
+    // a run of plain characters of one byte and one column each, or a single other character
+    enum class Kind : uint8_t {
+        run,
+        text,
+        tab,
+        invalid
+    };
+
+    struct Cell {
+        size_t offset;
+        int32_t column;
+        uint32_t size;
+        int32_t width;
+        Kind kind;
+    };
+
+    // the column of a cell, tabs tells if a tab comes before the next mark
+    struct Mark {
+        size_t offset;
+        int32_t column;
+        bool tabs;
+    };
+
+    using CellFunc = std::function<bool(const Cell &cell)>;
+
+    //--- private methods ---
+    bool scan(const size_t offset, const int32_t column, const CellFunc &func) const;
+    bool scanMarked(const Mark mark, const CellFunc &func);
+    Cell cellAt(const size_t offset);
+    Cell cellAtColumn(const int32_t column);
+    void resync(size_t from);
+
+    //--- private properties ---
+    const TextBuffer *_buffer = nullptr;
+    size_t _line = 0;
+    size_t _length = 0;
+    std::vector<Mark> _marks = {{0, 0, false}};
+    std::vector<Cell> _cells;
+    int32_t _first = 0;
+    int32_t _columns = -1;
+    int32_t _width = -1;
+};
+
+// The layouts of the lines looked at, built the first time a line is needed. Edits inside of a line
+// move its marks, edits changing lines drop the layouts from there on and everything else is reused,
+// so moving the cursor and drawing cost as much as the cells looked at and not as much as the lines.
+// A layout stays valid until the next get().
+class LayoutCache {
+public:
+    //--- public constants ---
+    static constexpr size_t max_lines = 4096;
+
+    //--- public constructors ---
+    LayoutCache();
+    LayoutCache(const LayoutCache &rhs) = delete;
+    LayoutCache(LayoutCache &&rhs) = delete;
+    ~LayoutCache() noexcept = default;
+
+    //--- public operators ---
+    LayoutCache &operator=(const LayoutCache &rhs) = delete;
+    LayoutCache &operator=(LayoutCache &&rhs) = delete;
+
+    //--- public methods ---
+    LineLayout &get(const TextBuffer &buffer, const size_t line, const int32_t first,
+                    const int32_t columns);
+    void edited(const size_t line, const size_t offset, const size_t removed, const size_t inserted);
+    void invalidate(const size_t first, const size_t last);
+
+private:
+    //--- private properties ---
+    std::unordered_map<size_t, LineLayout> _layouts;
+};
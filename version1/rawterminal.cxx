@@ -0,0 +1,493 @@
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cwchar>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+#include "terminal.hxx"
+
+// an escape not followed by the rest of a sequence within this time is a key of its own
+const int32_t escape_delay = 25;
+
+// the terminal is put back the way it was when the editor ends, resizing is noticed by a signal
+static struct termios original;
+static volatile sig_atomic_t resized = 0;
+
+static void onResize(int)
+{
+    resized = 1;
+}
+
+// the escape sequence setting a look, the colors are the ones the ncurses terminal uses
+static std::string sgrOf(const Terminal::Look look)
+{
+    static const char *const colors[] = {"", ";33", ";31", ";32", ";36", ";35", ";37;44"};
+    std::string sgr = "\033[0";
+
+    if (look & Terminal::bold)
+        sgr += ";1";
+    if (look & Terminal::reverse)
+        sgr += ";7";
+
+    return sgr + colors[std::min<size_t>(look & 0xff, Terminal::color_bar)] + "m";
+}
+
+static void writeAll(const std::string &data)
+{
+    for (size_t done = 0; done < data.size(); )
+    {
+        const ssize_t written = ::write(STDOUT_FILENO, data.data() + done, data.size() - done);
+
+        if (written > 0)
+            done += written;
+        else if ((written < 0) && (errno != EINTR) && (errno != EAGAIN))
+            break;
+    }
+}
+
+//--- public constructors ---
+
+Terminal::Terminal()
+: _cells(), _shown(), _output(), _input(), _written(0), _rows(0), _cols(0), _row(0), _col(0)
+{
+    struct termios raw;
+    struct sigaction action = {};
+
+    // no echo, no line editing, no signals and no translation of input or output, reads return
+    // what is there
+    ::tcgetattr(STDIN_FILENO, &original);
+    raw = original;
+    raw.c_iflag &= ~(BRKINT | ICRNL | INPCK | ISTRIP | IXON);
+    raw.c_oflag &= ~OPOST;
+    raw.c_cflag |= CS8;
+    raw.c_lflag &= ~(ECHO | ICANON | IEXTEN | ISIG);
+    raw.c_cc[VMIN] = 0;
+    raw.c_cc[VTIME] = 0;
+    ::tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
+
+    action.sa_handler = onResize;
+    ::sigaction(SIGWINCH, &action, nullptr);
+
+    // the alternate screen keeps what the terminal showed before, pastes are bracketed
+    _output = "\033[?1049h\033[?2004h";
+    measure();
+}
+
+Terminal::~Terminal() noexcept
+{
+    writeAll("\033[0m\033[?2004l\033[?1049l");
+    ::tcsetattr(STDIN_FILENO, TCSAFLUSH, &original);
+}
+
+//--- public methods ---
+
+int32_t Terminal::rows() const
+{
+    return _rows;
+}
+
+int32_t Terminal::cols() const
+{
+    return _cols;
+}
+
+void Terminal::put(const int32_t row, const int32_t col, const std::string &text, const Look look)
+{
+    std::mbstate_t state = {};
+    int32_t column = std::max(col, 0);
+
+    if ((row < 0) || (row >= _rows))
+        return;
+
+    // characters without width join the one in front of them, bytes which are no character show as
+    // '?', what does not fit into the row is cut off, wide characters written over in part are blank
+    for (size_t pos = 0; (pos < text.size()) && (column < _cols); )
+    {
+        Cell *cells = &_cells[row * _cols];
+        wchar_t code;
+        size_t length = std::mbrtowc(&code, text.data() + pos, text.size() - pos, &state);
+        int32_t width = 1;
+
+        if ((length == 0) || (length > (text.size() - pos)))
+        {
+            length = 1;
+            code = L'?';
+            state = {};
+        }
+        else
+            width = ::wcwidth(code);
+
+        if ((width == 0) && (column > col))
+        {
+            cells[column - 1 - cells[column - 1].text.empty()].text.append(text, pos, length);
+            pos += length;
+            continue;
+        }
+        if (width <= 0)
+        {
+            code = L'?';
+            width = 1;
+        }
+        if ((column + width) > _cols)
+            break;
+
+        if (cells[column].text.empty() && (column > 0))
+            cells[column - 1].text = " ";
+        if (((column + width) < _cols) && cells[column + width].text.empty())
+            cells[column + width].text = " ";
+        if (code == L'?')
+            cells[column].text = "?";
+        else
+            cells[column].text.assign(text, pos, length);
+        cells[column].look = look;
+        if (width == 2)
+            cells[column + 1] = {std::string(), look};
+        column += width;
+        pos += length;
+    }
+}
+
+void Terminal::paint(const int32_t row, const int32_t col, const int32_t count, const Look look)
+{
+    if ((row < 0) || (row >= _rows))
+        return;
+
+    for (int32_t column = std::max(col, 0); column < std::min(col + count, _cols); ++column)
+        _cells[(row * _cols) + column].look = look;
+}
+
+void Terminal::scrollRows(const int32_t first, const int32_t last, const int32_t count)
+{
+    const int32_t height = last - first + 1;
+
+    if (!count || (first < 0) || (last >= _rows) || (std::abs(count) >= height))
+        return;
+
+    // the terminal moves the rows it shows as well, so they do not have to be written again, the
+    // rows moved in are blank on both sides
+    for (std::vector<Cell> *grid : {&_cells, &_shown})
+    {
+        const auto begin = grid->begin() + (first * _cols);
+        const auto end = grid->begin() + ((last + 1) * _cols);
+
+        if (count > 0)
+        {
+            std::rotate(begin, begin + (count * _cols), end);
+            std::fill(end - (count * _cols), end, Cell{" ", color_text});
+        }
+        else
+        {
+            std::rotate(begin, end + (count * _cols), end);
+            std::fill(begin, begin - (count * _cols), Cell{" ", color_text});
+        }
+    }
+
+    _output += "\033[0m\033[" + std::to_string(first + 1) + ";" + std::to_string(last + 1) + "r\033["
+               + std::to_string(std::abs(count)) + ((count > 0) ? "S" : "T") + "\033[r";
+}
+
+void Terminal::cursor(const int32_t row, const int32_t col)
+{
+    _row = row;
+    _col = col;
+}
+
+void Terminal::flush()
+{
+    const Cell blank = {" ", color_text};
+    int32_t look = -1;
+    int32_t row = -1;
+    int32_t col = -1;
+
+    // changed cells are written where the cursor is already or behind a move, the look is only set
+    // when it changes, a wide character is written from its first column and the blank cells up to
+    // the end of a row are erased at once
+    for (int32_t y = 0; y < _rows; ++y)
+    {
+        const Cell *cells = &_cells[y * _cols];
+        Cell *shown = &_shown[y * _cols];
+        int32_t blanks = _cols;
+
+        while ((blanks > 0) && (cells[blanks - 1] == blank))
+            --blanks;
+
+        for (int32_t x = 0; x < _cols; ++x)
+        {
+            if (cells[x] == shown[x])
+                continue;
+
+            const int32_t start = x - ((x > 0) && cells[x].text.empty());
+            const int32_t width = (start >= blanks) ? (_cols - start)
+                                  : (1 + (((start + 1) < _cols) && cells[start + 1].text.empty()));
+
+            if ((row != y) || (col > start))
+                _output += "\033[" + std::to_string(y + 1) + ";" + std::to_string(start + 1) + "H";
+            else if (!skip(cells, col, start, look))
+                _output += "\033[" + std::to_string(start - col) + "C";
+            if (cells[start].look != look)
+                _output += sgrOf(cells[start].look);
+            if (start >= blanks)
+                _output += "\033[K";
+            else
+                _output += cells[start].text.empty() ? " " : cells[start].text;
+            std::copy_n(&cells[start], width, &shown[start]);
+            look = cells[start].look;
+            row = y;
+            col = start + width;
+            x = col - 1;
+        }
+    }
+
+    _output += "\033[" + std::to_string(_row + 1) + ";" + std::to_string(_col + 1) + "H";
+    _written += _output.size();
+    writeAll(_output);
+    _output.clear();
+}
+
+int32_t Terminal::read(const int32_t timeout)
+{
+    // a key is taken once all of its bytes arrived, a lone escape is a key after a short while
+    for (;;)
+    {
+        size_t length = 0;
+        int32_t key = input_none;
+
+        if (resized)
+        {
+            resized = 0;
+            measure();
+            return input_resize;
+        }
+
+        if (!_input.empty())
+            key = decode(length);
+        if (length)
+        {
+            _input.erase(0, length);
+            if (key != input_none)
+                return key;
+        }
+        else if (_input.empty())
+        {
+            if (!fill(timeout) && !resized)
+                return input_none;
+        }
+        else if (!fill(escape_delay) && !resized)
+        {
+            _input.erase(0, 1);
+            return 27;
+        }
+    }
+}
+
+size_t Terminal::written() const
+{
+    return _written;
+}
+
+//--- private operators ---
+
+bool Terminal::Cell::operator==(const Cell &rhs) const
+{
+    return (look == rhs.look) && (text == rhs.text);
+}
+
+bool Terminal::Cell::operator!=(const Cell &rhs) const
+{
+    return !(*this == rhs);
+}
+
+//--- private methods ---
+
+bool Terminal::skip(const Cell *cells, const int32_t from, const int32_t to, const int32_t look)
+{
+    size_t length = 0;
+
+    // a few unchanged cells of the current look are written again, a move costs more bytes
+    for (int32_t col = from; col < to; ++col)
+    {
+        if ((cells[col].look != look) || cells[col].text.empty() || (cells[col + 1].text.empty()))
+            return false;
+        length += cells[col].text.size();
+    }
+    if (length > 3)
+        return false;
+
+    for (int32_t col = from; col < to; ++col)
+        _output += cells[col].text;
+
+    return true;
+}
+
+void Terminal::measure()
+{
+    struct winsize size = {};
+
+    // a terminal not telling its size is the classic one, after clearing it shows blank cells only
+    if ((::ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) < 0) || !size.ws_row || !size.ws_col)
+    {
+        size.ws_row = 24;
+        size.ws_col = 80;
+    }
+    _rows = size.ws_row;
+    _cols = size.ws_col;
+    _cells.assign(_rows * _cols, {" ", color_text});
+    _shown = _cells;
+    _output += "\033[0m\033[2J";
+}
+
+bool Terminal::fill(const int32_t timeout)
+{
+    struct pollfd input = {STDIN_FILENO, POLLIN, 0};
+    char data[4096];
+
+    if (::poll(&input, 1, timeout) <= 0)
+        return false;
+
+    const ssize_t length = ::read(STDIN_FILENO, data, sizeof (data));
+
+    if (length <= 0)
+        return false;
+    _input.append(data, length);
+
+    return true;
+}
+
+int32_t Terminal::decode(size_t &length) const
+{
+    const uint8_t byte = _input[0];
+    size_t end = 2;
+
+    // a length of 0 means the sequence is not complete yet
+    length = 1;
+    if (byte == '\r')
+        return '\n';
+    if ((byte == 0x7f) || (byte == 0x08))
+        return input_backspace;
+    if (byte != 0x1b)
+        return byte;
+
+    length = 0;
+    if (_input.size() < 3)
+        return input_none;
+
+    // SS3 sequences of the cursor keys and the first function keys
+    if (_input[1] == 'O')
+    {
+        length = 3;
+        switch (_input[2])
+        {
+            case 'A':
+                return input_up;
+            case 'B':
+                return input_down;
+            case 'C':
+                return input_right;
+            case 'D':
+                return input_left;
+            case 'H':
+                return input_home;
+            case 'F':
+                return input_end;
+            case 'P':
+            case 'Q':
+            case 'R':
+            case 'S':
+                return input_f0 + 1 + (_input[2] - 'P');
+            default:
+                return input_none;
+        }
+    }
+
+    // an escape in front of anything else is a key of its own
+    if (_input[1] != '[')
+    {
+        length = 1;
+        return 27;
+    }
+
+    // CSI sequences, parameters and intermediate bytes come in front of the final byte, the second
+    // parameter is one more than the modifiers held, only control is told apart for home and end
+    while ((end < _input.size()) && (_input[end] >= 0x20) && (_input[end] < 0x40))
+        ++end;
+    if (end >= _input.size())
+        return input_none;
+
+    const int32_t number = std::atoi(_input.c_str() + 2);
+    const size_t split = _input.find(';', 2);
+    const bool ctrl = (split < end) && ((std::atoi(_input.c_str() + split + 1) - 1) & 4);
+
+    length = end + 1;
+    switch (_input[end])
+    {
+        case 'A':
+            return input_up;
+        case 'B':
+            return input_down;
+        case 'C':
+            return input_right;
+        case 'D':
+            return input_left;
+        case 'H':
+            return ctrl ? input_ctrl_home : input_home;
+        case 'F':
+            return ctrl ? input_ctrl_end : input_end;
+        case '~':
+            break;
+        default:
+            return input_none;
+    }
+
+    switch (number)
+    {
+        case 1:
+        case 7:
+            return input_home;
+        case 4:
+        case 8:
+            return input_end;
+        case 3:
+            return input_delete;
+        case 5:
+            return input_page_up;
+        case 6:
+            return input_page_down;
+        case 200:
+            return input_paste_begin;
+        case 201:
+            return input_paste_end;
+        default:
+            break;
+    }
+
+    // function keys skip numbers, F5 is 15, F6 is 17 and F11 is 23
+    if ((number >= 11) && (number <= 15))
+        return input_f0 + (number - 10);
+    if ((number >= 17) && (number <= 21))
+        return input_f0 + (number - 11);
+    if ((number >= 23) && (number <= 26))
+        return input_f0 + (number - 12);
+
+    return input_none;
+}
@@ -0,0 +1,814 @@
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include <cctype>
+#include "regex.hxx"
+
+// repetitions are copies of what they repeat, this keeps patterns like a{1000}{1000} in bounds
+const size_t max_insts = 64 * 1024;
+// every DFA state has a row of transitions, the cache starts over when it is full
+const size_t max_states = 4096;
+const uint32_t unbounded = UINT32_MAX;
+const uint32_t max_count = 1000;
+
+// parse tree of a pattern
+struct Regex::Node {
+    enum class Type {
+        empty,
+        bytes,
+        line_start,
+        line_end,
+        concat,
+        alt,
+        repeat
+    };
+
+    Node(const Type type = Type::empty)
+    : type(type), set(0), min(0), max(0), greedy(true), children()
+    {
+    }
+
+    Type type;
+    uint32_t set;
+    uint32_t min;
+    uint32_t max;
+    bool greedy;
+    std::vector<Node> children;
+};
+
+// Recursive descent over the pattern, byte sets are collected once for both directions.
+class Regex::Parser {
+public:
+    //--- public constructors ---
+    Parser(const std::string &pattern, std::vector<std::bitset<256>> &sets)
+    : _pattern(pattern), _sets(sets), _error(), _pos(0)
+    {
+    }
+
+    Parser(const Parser &rhs) = delete;
+    Parser(Parser &&rhs) = delete;
+    ~Parser() noexcept = default;
+
+    //--- public operators ---
+    Parser &operator=(const Parser &rhs) = delete;
+    Parser &operator=(Parser &&rhs) = delete;
+
+    //--- public methods ---
+    bool parse(Node &root)
+    {
+        if (!parseAlt(root))
+            return false;
+        if (more())
+            return fail("unmatched )");
+
+        return true;
+    }
+
+    const std::string &error() const
+    {
+        return _error;
+    }
+
+private:
+    //--- private methods ---
+    bool fail(const char *error)
+    {
+        _error = error;
+        return false;
+    }
+
+    bool more() const
+    {
+        return _pos < _pattern.size();
+    }
+
+    bool next(const char chr)
+    {
+        if (!more() || (_pattern[_pos] != chr))
+            return false;
+        ++_pos;
+
+        return true;
+    }
+
+    void bytes(Node &node, const std::bitset<256> &set)
+    {
+        node = Node(Node::Type::bytes);
+        node.set = _sets.size();
+        _sets.push_back(set);
+    }
+
+    bool parseAlt(Node &node)
+    {
+        node = Node(Node::Type::alt);
+        do
+        {
+            node.children.emplace_back();
+            if (!parseConcat(node.children.back()))
+                return false;
+        }
+        while (next('|'));
+
+        if (node.children.size() == 1)
+        {
+            Node single = std::move(node.children.front());
+
+            node = std::move(single);
+        }
+
+        return true;
+    }
+
+    bool parseConcat(Node &node)
+    {
+        node = Node(Node::Type::concat);
+        while (more() && (_pattern[_pos] != '|') && (_pattern[_pos] != ')'))
+        {
+            node.children.emplace_back();
+            if (!parseAtom(node.children.back()) || !parseRepeats(node.children.back()))
+                return false;
+        }
+
+        return true;
+    }
+
+    bool parseRepeats(Node &node)
+    {
+        while (more() && std::string("*+?{").find(_pattern[_pos]) != std::string::npos)
+        {
+            Node repeat(Node::Type::repeat);
+            const char chr = _pattern[_pos++];
+
+            repeat.min = (chr == '+') ? 1 : 0;
+            repeat.max = (chr == '?') ? 1 : unbounded;
+            if ((chr == '{') && !parseCount(repeat.min, repeat.max))
+                return false;
+            repeat.greedy = !next('?');
+            repeat.children.push_back(std::move(node));
+            node = std::move(repeat);
+        }
+
+        return true;
+    }
+
+    bool parseNumber(uint32_t &number)
+    {
+        const size_t start = _pos;
+
+        for (number = 0; more() && std::isdigit(static_cast<unsigned char>(_pattern[_pos])); ++_pos)
+        {
+            number = number * 10 + (_pattern[_pos] - '0');
+            if (number > max_count)
+                return fail("repetition too large");
+        }
+
+        return (_pos > start) || fail("bad repetition");
+    }
+
+    bool parseCount(uint32_t &min, uint32_t &max)
+    {
+        if (!parseNumber(min))
+            return false;
+        max = min;
+        if (next(','))
+        {
+            if (next('}'))
+            {
+                max = unbounded;
+                return true;
+            }
+            if (!parseNumber(max))
+                return false;
+            if (max < min)
+                return fail("bad repetition");
+        }
+
+        return next('}') || fail("bad repetition");
+    }
+
+    bool parseAtom(Node &node)
+    {
+        const char chr = _pattern[_pos++];
+        std::bitset<256> set;
+
+        switch (chr)
+        {
+            case '(':
+                if (!parseAlt(node))
+                    return false;
+                return next(')') || fail("missing )");
+
+            case '[':
+                return parseClass(node);
+
+            case '.':
+                bytes(node, set.set().reset('\n'));
+                return true;
+
+            case '^':
+                node = Node(Node::Type::line_start);
+                return true;
+
+            case '$':
+                node = Node(Node::Type::line_end);
+                return true;
+
+            case '*':
+            case '+':
+            case '?':
+            case '{':
+                return fail("nothing to repeat");
+
+            case '\\':
+                if (!parseEscape(set))
+                    return false;
+                bytes(node, set);
+                return true;
+
+            default:
+                bytes(node, set.set(static_cast<unsigned char>(chr)));
+                return true;
+        }
+    }
+
+    bool parseEscape(std::bitset<256> &set)
+    {
+        std::bitset<256> escaped;
+
+        if (!more())
+            return fail("trailing \\");
+
+        const char chr = _pattern[_pos++];
+
+        switch (std::tolower(static_cast<unsigned char>(chr)))
+        {
+            case 'd':
+                for (uint32_t i = '0'; i <= '9'; ++i)
+                    escaped.set(i);
+                break;
+
+            case 'w':
+                for (uint32_t i = 0; i < 256; ++i)
+                    escaped.set(i, std::isalnum(i) || (i == '_'));
+                break;
+
+            case 's':
+                for (const char space : std::string(" \t\n\r\f\v"))
+                    escaped.set(static_cast<unsigned char>(space));
+                break;
+
+            case 'n':
+                escaped.set('\n');
+                break;
+
+            case 't':
+                escaped.set('\t');
+                break;
+
+            case 'r':
+                escaped.set('\r');
+                break;
+
+            default:
+                if (std::isalnum(static_cast<unsigned char>(chr)))
+                    return fail("unknown escape");
+                escaped.set(static_cast<unsigned char>(chr));
+        }
+
+        // the upper case classes are the negated ones
+        if (std::isupper(static_cast<unsigned char>(chr)))
+        {
+            if (std::string("DWS").find(chr) == std::string::npos)
+                return fail("unknown escape");
+            escaped.flip();
+        }
+        set |= escaped;
+
+        return true;
+    }
+
+    bool parseClass(Node &node)
+    {
+        std::bitset<256> set;
+        const bool negated = next('^');
+
+        // a ] right at the start is a literal one
+        for (bool first = true; !next(']') || first; first = false)
+        {
+            if (!more())
+                return fail("missing ]");
+
+            const unsigned char low = _pattern[_pos++];
+
+            if (low == '\\')
+            {
+                if (!parseEscape(set))
+                    return false;
+            }
+            else if (((_pos + 1) < _pattern.size()) && (_pattern[_pos] == '-')
+                     && (_pattern[_pos + 1] != ']'))
+            {
+                const unsigned char high = _pattern[_pos + 1];
+
+                if (high < low)
+                    return fail("bad range");
+                for (uint32_t i = low; i <= high; ++i)
+                    set.set(i);
+                _pos += 2;
+            }
+            else
+                set.set(low);
+        }
+
+        bytes(node, negated ? set.flip() : set);
+
+        return true;
+    }
+
+    //--- private properties ---
+    const std::string &_pattern;
+    std::vector<std::bitset<256>> &_sets;
+    std::string _error;
+    size_t _pos;
+};
+
+//--- public constructors ---
+
+Regex::Regex()
+: _pattern(), _error("no pattern"), _sets(), _forward(), _reverse(), _chunks(), _chunk(0), _total(0),
+  _forward_dfa(), _reverse_dfa()
+{
+}
+
+//--- public methods ---
+
+bool Regex::compile(const std::string &pattern)
+{
+    Node root;
+    Parser parser(pattern, _sets);
+
+    _pattern = pattern;
+    _error.clear();
+    _sets.clear();
+    _forward.clear();
+    _reverse.clear();
+
+    // the forward program skips any bytes in front of a match, but prefers matching to skipping
+    _sets.push_back(std::bitset<256>().set());
+    _forward = {{Inst::split, 3, 1}, {Inst::byte, 0, 0}, {Inst::jump, 0, 0}};
+
+    if (!parser.parse(root))
+        _error = parser.error();
+    else if (!emit(root, _forward, false) || !emit(root, _reverse, true))
+        _error = "pattern too large";
+    if (!_error.empty())
+    {
+        _forward.clear();
+        _reverse.clear();
+        return false;
+    }
+
+    _forward.push_back({Inst::match, 0, 0});
+    _reverse.push_back({Inst::match, 0, 0});
+    _forward_dfa.reset(&_forward, &_sets, true);
+    _reverse_dfa.reset(&_reverse, &_sets, false);
+
+    return true;
+}
+
+bool Regex::valid() const
+{
+    return !_forward.empty();
+}
+
+const std::string &Regex::pattern() const
+{
+    return _pattern;
+}
+
+const std::string &Regex::error() const
+{
+    return _error;
+}
+
+bool Regex::find(const TextBuffer &buffer, size_t pos, TextBuffer::Range &match)
+{
+    if (!valid())
+        return false;
+
+    collect(buffer, pos);
+
+    const bool found = search(pos, match);
+
+    _chunks.clear();
+
+    return found;
+}
+
+bool Regex::forEachMatch(const TextBuffer &buffer, size_t pos,
+                         const std::function<bool(const TextBuffer::Range &match)> &func)
+{
+    TextBuffer::Range match;
+    bool result = true;
+
+    if (!valid())
+        return true;
+
+    // the matches follow each other without overlapping, an empty one moves the search on by a byte
+    collect(buffer, pos);
+    for (; (pos <= _total) && search(pos, match); pos = match.pos + std::max<size_t>(match.length, 1))
+    {
+        if (!func(match))
+        {
+            result = false;
+            break;
+        }
+    }
+    _chunks.clear();
+
+    return result;
+}
+
+void Regex::release()
+{
+    // the states are built again by the next search
+    _forward_dfa.release();
+    _reverse_dfa.release();
+    _chunks = std::vector<Chunk>();
+    _chunk = 0;
+}
+
+//--- private methods ---
+
+void Regex::collect(const TextBuffer &buffer, const size_t pos)
+{
+    // the spans are looked up once for all searches, starting with the byte in front of pos
+    const size_t start = pos ? (pos - 1) : 0;
+
+    _chunks.clear();
+    _chunk = 0;
+    _total = buffer.size() + buffer.unindexed();
+    buffer.forEachSpan(start, SIZE_MAX, [this, offset = start](const char *data,
+                                                               size_t length) mutable {
+        _chunks.push_back({data, offset, length});
+        offset += length;
+        return true;
+    });
+}
+
+size_t Regex::chunkOf(const size_t pos)
+{
+    // searches mostly move forward a little, the chunk of the last lookup and the one behind it are
+    // tried first
+    for (size_t i = _chunk; (i < _chunks.size()) && (i <= (_chunk + 1)); ++i)
+    {
+        if ((pos >= _chunks[i].pos) && (pos < (_chunks[i].pos + _chunks[i].length)))
+            return _chunk = i;
+    }
+
+    const auto chunk = std::upper_bound(_chunks.begin(), _chunks.end(), pos,
+                                        [](size_t value, const Chunk &chunk) {
+        return value < chunk.pos;
+    });
+
+    return _chunk = chunk - _chunks.begin() - 1;
+}
+
+uint32_t Regex::symbolAt(const size_t pos)
+{
+    if (pos >= _total)
+        return Dfa::end_symbol;
+
+    const Chunk &chunk = _chunks[chunkOf(pos)];
+
+    return static_cast<unsigned char>(chunk.data[pos - chunk.pos]);
+}
+
+bool Regex::search(const size_t pos, TextBuffer::Range &match)
+{
+    if (pos > _total)
+        return false;
+
+    // forward from pos: where the leftmost match ends, the search stops once no thread is left
+    int32_t state = _forward_dfa.start(!pos || (symbolAt(pos - 1) == '\n'));
+    size_t end = SIZE_MAX;
+
+    for (size_t i = (pos < _total) ? chunkOf(pos) : _chunks.size(); state && (i < _chunks.size()); ++i)
+    {
+        const Chunk &chunk = _chunks[i];
+        const size_t offset = std::max(pos, chunk.pos) - chunk.pos;
+        size_t matched = SIZE_MAX;
+
+        _forward_dfa.scan(chunk.data + offset, chunk.length - offset, state, matched);
+        if (matched != SIZE_MAX)
+            end = chunk.pos + offset + matched;
+    }
+    if (state && (_forward_dfa.step(state, Dfa::end_symbol) & 1))
+        end = _total;
+
+    if (end == SIZE_MAX)
+        return false;
+
+    // backward from the end: the longest match of the reversed pattern is where the match starts
+    size_t start = end;
+    size_t at = end;
+
+    state = _reverse_dfa.start(symbolAt(end) == '\n' || (end == _total));
+    for (size_t i = chunkOf(at ? (at - 1) : 0); state && (at > pos); --i)
+    {
+        const Chunk &chunk = _chunks[i];
+
+        for (; state && (at > std::max(pos, chunk.pos)); --at)
+        {
+            const uint32_t symbol = static_cast<unsigned char>(chunk.data[at - 1 - chunk.pos]);
+            const int32_t next = _reverse_dfa.step(state, symbol);
+
+            if (next & 1)
+                start = at;
+            state = next >> 1;
+        }
+    }
+
+    // the byte in front of the search start only decides whether ^ matches there
+    if (state && (_reverse_dfa.step(state, pos ? symbolAt(pos - 1) : Dfa::end_symbol) & 1))
+        start = pos;
+
+    match = {start, end - start};
+
+    return true;
+}
+
+bool Regex::emit(const Node &node, std::vector<Inst> &insts, const bool reverse) const
+{
+    // the reversed program reads the text backwards, line starts and ends swap places
+    switch (node.type)
+    {
+        case Node::Type::empty:
+            break;
+
+        case Node::Type::bytes:
+            insts.push_back({Inst::byte, node.set, 0});
+            break;
+
+        case Node::Type::line_start:
+            insts.push_back({reverse ? Inst::line_end : Inst::line_start, 0, 0});
+            break;
+
+        case Node::Type::line_end:
+            insts.push_back({reverse ? Inst::line_start : Inst::line_end, 0, 0});
+            break;
+
+        case Node::Type::concat:
+            for (size_t i = 0; i < node.children.size(); ++i)
+            {
+                if (!emit(node.children[reverse ? (node.children.size() - i - 1) : i], insts,
+                          reverse))
+                    return false;
+            }
+            break;
+
+        case Node::Type::alt:
+        {
+            std::vector<size_t> jumps;
+
+            // split to this alternative or the next, every one but the last jumps behind the others
+            for (size_t i = 0; i < node.children.size(); ++i)
+            {
+                const size_t split = insts.size();
+                const bool last = (i + 1) == node.children.size();
+
+                if (!last)
+                    insts.push_back({Inst::split, static_cast<uint32_t>(split + 1), 0});
+                if (!emit(node.children[i], insts, reverse))
+                    return false;
+                if (!last)
+                {
+                    jumps.push_back(insts.size());
+                    insts.push_back({Inst::jump, 0, 0});
+                    insts[split].y = insts.size();
+                }
+            }
+            for (const size_t jump : jumps)
+                insts[jump].x = insts.size();
+            break;
+        }
+
+        case Node::Type::repeat:
+        {
+            const Node &child = node.children.front();
+
+            for (uint32_t i = 0; i < node.min; ++i)
+            {
+                if (!emit(child, insts, reverse))
+                    return false;
+            }
+
+            // optional copies split to the copy or behind it, unbounded ones loop back to the split
+            for (uint32_t i = node.min; (i < node.max) && (insts.size() <= max_insts); ++i)
+            {
+                const uint32_t split = insts.size();
+
+                insts.push_back({Inst::split, 0, 0});
+                if (!emit(child, insts, reverse))
+                    return false;
+                if (node.max == unbounded)
+                    insts.push_back({Inst::jump, split, 0});
+
+                const uint32_t inside = split + 1;
+                const uint32_t behind = insts.size();
+
+                insts[split].x = node.greedy ? inside : behind;
+                insts[split].y = node.greedy ? behind : inside;
+                if (node.max == unbounded)
+                    break;
+            }
+            break;
+        }
+    }
+
+    return insts.size() <= max_insts;
+}
+
+//--- dfa ---
+
+void Regex::Dfa::reset(const std::vector<Inst> *insts, const std::vector<std::bitset<256>> *sets,
+                       const bool leftmost)
+{
+    _insts = insts;
+    _sets = sets;
+    _leftmost = leftmost;
+    _marks.assign(insts->size(), 0);
+    _mark = 0;
+    flush();
+}
+
+int32_t Regex::Dfa::start(const bool line_start)
+{
+    bool flushed;
+
+    // the start states are needed for every search, they are kept until the cache starts over
+    if (_starts[line_start] < 0)
+    {
+        const int32_t id = intern({line_start, 0}, flushed);
+
+        _starts[line_start] = id;
+    }
+
+    return _starts[line_start];
+}
+
+bool Regex::Dfa::scan(const char *data, const size_t length, int32_t &state, size_t &matched)
+{
+    // the table only moves when a new state is added
+    const int32_t *table = _table.data();
+    int32_t current = state;
+
+    for (size_t i = 0; i < length; ++i)
+    {
+        const uint32_t symbol = static_cast<unsigned char>(data[i]);
+        int32_t next = table[current + symbol];
+
+        if (next < 0)
+        {
+            next = build(current, symbol);
+            table = _table.data();
+        }
+        if (next & 1)
+            matched = i;
+        if (!(current = next >> 1))
+            break;
+    }
+    state = current;
+
+    return current;
+}
+
+void Regex::Dfa::release()
+{
+    flush();
+    _states.shrink_to_fit();
+    _table.shrink_to_fit();
+    _stack = std::vector<uint32_t>();
+}
+
+//--- private methods ---
+
+int32_t Regex::Dfa::build(const int32_t state, const uint32_t symbol)
+{
+    // a state is whether the last byte ended a line and the threads in priority order, every thread
+    // is followed through its empty transitions depth first, a state reached before on a thread of
+    // higher priority is not visited again
+    const std::vector<uint32_t> &threads = _states[state / symbols];
+    const bool line_end = (symbol == '\n') || (symbol == end_symbol);
+    std::vector<uint32_t> next = {symbol == '\n'};
+    bool matched = false;
+
+    if (!++_mark)
+    {
+        std::fill(_marks.begin(), _marks.end(), 0);
+        _mark = 1;
+    }
+    for (size_t i = threads.size(); i-- > 1;)
+        _stack.push_back(threads[i]);
+
+    while (!_stack.empty())
+    {
+        const uint32_t pc = _stack.back();
+        const Inst &inst = (*_insts)[pc];
+
+        _stack.pop_back();
+        if (_marks[pc] == _mark)
+            continue;
+        _marks[pc] = _mark;
+
+        switch (inst.op)
+        {
+            case Inst::byte:
+                if ((symbol != end_symbol) && (*_sets)[inst.x][symbol])
+                    next.push_back(pc + 1);
+                break;
+
+            case Inst::split:
+                _stack.push_back(inst.y);
+                _stack.push_back(inst.x);
+                break;
+
+            case Inst::jump:
+                _stack.push_back(inst.x);
+                break;
+
+            case Inst::line_start:
+                if (threads[0])
+                    _stack.push_back(pc + 1);
+                break;
+
+            case Inst::line_end:
+                if (line_end)
+                    _stack.push_back(pc + 1);
+                break;
+
+            case Inst::match:
+                // threads of lower priority than a match can not win anymore
+                matched = true;
+                if (_leftmost)
+                    _stack.clear();
+                break;
+        }
+    }
+
+    bool flushed = false;
+    const int32_t id = (next.size() > 1) ? intern(std::move(next), flushed) : 0;
+    const int32_t result = (id << 1) | matched;
+
+    if (!flushed)
+        _table[state + symbol] = result;
+
+    return result;
+}
+
+int32_t Regex::Dfa::intern(std::vector<uint32_t> &&threads, bool &flushed)
+{
+    const auto found = _ids.find(threads);
+
+    if (found != _ids.end())
+        return found->second;
+
+    flushed = _states.size() >= max_states;
+    if (flushed)
+        flush();
+
+    const int32_t id = _states.size() * symbols;
+
+    _ids.emplace(threads, id);
+    _states.push_back(std::move(threads));
+    _table.resize(_table.size() + symbols, -1);
+
+    return id;
+}
+
+void Regex::Dfa::flush()
+{
+    // state 0 has no threads left, it never matches and never leaves
+    _ids.clear();
+    _starts[0] = -1;
+    _starts[1] = -1;
+    _states.assign(1, {0});
+    _table.assign(symbols, 0);
+}
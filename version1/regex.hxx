@@ -0,0 +1,152 @@
+#pragma once
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <bitset>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include "textbuffer.hxx"
+
+// Regular expressions without backtracking. A pattern is compiled into a Thompson NFA, which is run
+// as a DFA built lazily while searching: DFA states are sets of NFA states, created the first time
+// the search runs into them and cached together with their transitions. Every byte costs a table
+// lookup once the states it needs exist, so searching takes time linear to the text, whatever the
+// pattern looks like. A forward pass finds where the leftmost match ends, a backward pass of the
+// reversed pattern from there finds where it starts.
+//
+// Patterns know literals, . for any byte but a line feed, [] classes with ranges and ^, \d \w \s
+// and their negations \D \W \S, \n \t \r, \ in front of any other punctuation, groups (), | and
+// the repetitions * + ? {n} {n,} {n,m}, which are lazy when followed by ?. ^ and $ match at the start
+// and end of lines. Matching works on bytes, alternatives are preferred from left to right.
+class Regex {
+public:
+    //--- public constructors ---
+    Regex();
+    Regex(const Regex &rhs) = delete;
+    Regex(Regex &&rhs) = delete;
+    ~Regex() noexcept = default;
+
+    //--- public operators ---
+    Regex &operator=(const Regex &rhs) = delete;
+    Regex &operator=(Regex &&rhs) = delete;
+
+    //--- public methods ---
+    bool compile(const std::string &pattern);
+    bool valid() const;
+    const std::string &pattern() const;
+    const std::string &error() const;
+
+    bool find(const TextBuffer &buffer, size_t pos, TextBuffer::Range &match);
+    bool forEachMatch(const TextBuffer &buffer, size_t pos,
+                      const std::function<bool(const TextBuffer::Range &match)> &func);
+    void release();
+
+private:
+    //--- private types ---
+    struct Node;
+    class Parser;
+
+    // a span of the searched content and where it is
+    struct Chunk {
+        const char *data;
+        size_t pos;
+        size_t length;
+    };
+
+    struct Inst {
+        enum Op : uint8_t {
+            byte,
+            split,
+            jump,
+            line_start,
+            line_end,
+            match
+        };
+
+        Op op;
+        uint32_t x;
+        uint32_t y;
+    };
+
+    // the lazily built DFA of one program, leftmost means the first match in priority order ends the
+    // search, otherwise it runs for the longest match
+    class Dfa {
+    public:
+        //--- public constants ---
+        static constexpr uint32_t end_symbol = 256;
+        static constexpr uint32_t symbols = 257;
+
+        //--- public methods ---
+        void reset(const std::vector<Inst> *insts, const std::vector<std::bitset<256>> *sets,
+                   const bool leftmost);
+        int32_t start(const bool line_start);
+
+        // states are the offsets of their rows in the transition table, a step returns the next
+        // state shifted left by one, the lowest bit tells whether a match ended in front of the
+        // symbol, known transitions are a lookup
+        int32_t step(const int32_t state, const uint32_t symbol)
+        {
+            const int32_t next = _table[state + symbol];
+
+            return (next >= 0) ? next : build(state, symbol);
+        }
+
+        bool scan(const char *data, const size_t length, int32_t &state, size_t &matched);
+        void release();
+
+    private:
+        //--- private methods ---
+        int32_t build(const int32_t state, const uint32_t symbol);
+        int32_t intern(std::vector<uint32_t> &&threads, bool &flushed);
+        void flush();
+
+        //--- private properties ---
+        const std::vector<Inst> *_insts = nullptr;
+        const std::vector<std::bitset<256>> *_sets = nullptr;
+        std::map<std::vector<uint32_t>, int32_t> _ids;
+        std::vector<std::vector<uint32_t>> _states;
+        std::vector<int32_t> _table;
+        std::vector<uint32_t> _marks;
+        std::vector<uint32_t> _stack;
+        int32_t _starts[2] = {-1, -1};
+        uint32_t _mark = 0;
+        bool _leftmost = true;
+    };
+
+    //--- private methods ---
+    bool emit(const Node &node, std::vector<Inst> &insts, const bool reverse) const;
+    void collect(const TextBuffer &buffer, const size_t pos);
+    size_t chunkOf(const size_t pos);
+    uint32_t symbolAt(const size_t pos);
+    bool search(const size_t pos, TextBuffer::Range &match);
+
+    //--- private properties ---
+    std::string _pattern;
+    std::string _error;
+    std::vector<std::bitset<256>> _sets;
+    std::vector<Inst> _forward;
+    std::vector<Inst> _reverse;
+    std::vector<Chunk> _chunks;
+    size_t _chunk;
+    size_t _total;
+    Dfa _forward_dfa;
+    Dfa _reverse_dfa;
+};
@@ -0,0 +1,221 @@
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include "search.hxx"
+
+//--- public constructors ---
+
+SearchJob::SearchJob()
+: _buffer(), _needle(), _chunks(), _threads(), _mutex(), _resolved(), _next(0), _count(0),
+  _pending(0), _match(SIZE_MAX), _found(true), _stop(false), _first_open(0), _start_chunk(0),
+  _count_open(0), _count_end(0)
+{
+}
+
+SearchJob::~SearchJob() noexcept
+{
+    cancel();
+}
+
+//--- public methods ---
+
+void SearchJob::start(const TextBuffer &buffer, const std::string &needle, const size_t pos)
+{
+    const size_t size = buffer.size() + buffer.unindexed();
+    const size_t from = std::min(pos, size);
+
+    cancel();
+    _buffer = buffer;
+    _needle = needle;
+    _chunks.clear();
+    _next = 0;
+    _count = 0;
+    _match = SIZE_MAX;
+    _found = false;
+    _stop = false;
+    _first_open = 0;
+    _count_open = 0;
+    _count_end = 0;
+
+    // search order: from the position to the end, then from the start up to the position, the
+    // chunk at the start of the buffer is the first one of the second part
+    for (size_t chunk = from; chunk < size; chunk += chunk_size)
+        _chunks.push_back({chunk, std::min(chunk_size, size - chunk), SIZE_MAX, 0, chunk, false});
+    _start_chunk = _chunks.size();
+    for (size_t chunk = 0; chunk < from; chunk += chunk_size)
+        _chunks.push_back({chunk, std::min(chunk_size, from - chunk), SIZE_MAX, 0, chunk, false});
+
+    _pending = _chunks.size();
+    if (_needle.empty() || _chunks.empty())
+    {
+        _pending = 0;
+        _found = true;
+        return;
+    }
+
+    const size_t workers = std::min<size_t>(std::max(std::thread::hardware_concurrency(), 1u),
+                                            _chunks.size());
+
+    for (size_t i = 0; i < workers; ++i)
+        _threads.emplace_back([this]() { work(); });
+}
+
+void SearchJob::cancel()
+{
+    _stop = true;
+    for (auto &thread : _threads)
+        thread.join();
+    _threads.clear();
+
+    // nothing reads the snapshot anymore, the memory of content replaced in the meantime is released
+    _buffer.clear();
+}
+
+void SearchJob::wait()
+{
+    for (auto &thread : _threads)
+        thread.join();
+    _threads.clear();
+    _buffer.clear();
+}
+
+bool SearchJob::active() const
+{
+    return !_threads.empty();
+}
+
+bool SearchJob::found() const
+{
+    return _found;
+}
+
+size_t SearchJob::match()
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+
+    _resolved.wait(lock, [this]() { return _found || _stop; });
+
+    return _match;
+}
+
+bool SearchJob::counted() const
+{
+    return !_pending;
+}
+
+size_t SearchJob::count() const
+{
+    return _count;
+}
+
+//--- private methods ---
+
+void SearchJob::work()
+{
+    for (size_t next = _next++; !_stop && (next < _chunks.size()); next = _next++)
+    {
+        Chunk &chunk = _chunks[next];
+        size_t first = SIZE_MAX;
+        size_t count = 0;
+        size_t end = chunk.pos;
+
+        // counted in batches, a chunk full of matches would otherwise make the counter bounce
+        // between the workers, matches overlapping the last one counted are skipped
+        _buffer.forEachMatch(_needle, chunk.pos, chunk.length, [&](size_t match) {
+            if (first == SIZE_MAX)
+                first = match;
+            if (match >= end)
+            {
+                end = match + _needle.size();
+                if (!(++count % 4096))
+                    _count += 4096;
+            }
+
+            return !_stop;
+        });
+        _count += count % 4096;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        chunk.first = first;
+        chunk.count = count;
+        chunk.end = end;
+        chunk.done = true;
+        resolve();
+    }
+}
+
+void SearchJob::resolve()
+{
+    // the first match is the first one of the first chunk with any, once all chunks before it are done
+    while (!_found && (_first_open < _chunks.size()) && _chunks[_first_open].done)
+    {
+        if (_chunks[_first_open].first != SIZE_MAX)
+        {
+            _match = _chunks[_first_open].first;
+            _found = true;
+        }
+        ++_first_open;
+    }
+    if (_first_open == _chunks.size())
+        _found = true;
+
+    if (_found)
+        _resolved.notify_all();
+
+    // the count is final for every chunk done in buffer order, from the start of the buffer on
+    while (_count_open < _chunks.size())
+    {
+        Chunk &chunk = _chunks[(_start_chunk + _count_open) % _chunks.size()];
+
+        if (!chunk.done)
+            break;
+        if ((chunk.first != SIZE_MAX) && (chunk.first < _count_end))
+            recount(chunk, _count_end);
+        _count_end = std::max(_count_end, chunk.end);
+        ++_count_open;
+        --_pending;
+    }
+}
+
+void SearchJob::recount(Chunk &chunk, const size_t from)
+{
+    const size_t limit = chunk.pos + chunk.length;
+    const size_t counted = chunk.count;
+    size_t count = 0;
+    size_t end = from;
+
+    // rare, only a match crossing the border to the chunk in front starts it somewhere else
+    if (from < limit)
+        _buffer.forEachMatch(_needle, from, limit - from, [&](size_t match) {
+            if (match >= end)
+            {
+                end = match + _needle.size();
+                ++count;
+            }
+
+            return !_stop;
+        });
+
+    chunk.count = count;
+    chunk.end = end;
+    _count += count;
+    _count -= counted;
+}
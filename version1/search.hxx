@@ -0,0 +1,98 @@
+#pragma once
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "textbuffer.hxx"
+
+// Searches a snapshot of the buffer on a pool of worker threads. The content is split into chunks
+// in search order, starting at the search position and wrapping around at the end. The workers take
+// the chunks in that order and every chunk is searched a needle length minus one further than it
+// reaches, so matches crossing chunk borders are found in the chunk they start in. The first match
+// is known as soon as every chunk before it is done, while the other workers keep counting all
+// matches of the buffer. Overlapping matches are counted the way replace-all replaces them, from
+// the front of the buffer on every match starting behind the last one counted. Every chunk counts
+// its own matches like that, a chunk whose first match overlaps the last one of the chunk in front
+// of it is counted again from behind that match once the chunk in front is done. The editor polls
+// the first match and the count.
+class SearchJob {
+public:
+    //--- public constants ---
+    static constexpr size_t chunk_size = 16 * 1024 * 1024;
+
+    //--- public constructors ---
+    SearchJob();
+    SearchJob(const SearchJob &rhs) = delete;
+    SearchJob(SearchJob &&rhs) = delete;
+    ~SearchJob() noexcept;
+
+    //--- public operators ---
+    SearchJob &operator=(const SearchJob &rhs) = delete;
+    SearchJob &operator=(SearchJob &&rhs) = delete;
+
+    //--- public methods ---
+    void start(const TextBuffer &buffer, const std::string &needle, const size_t pos);
+    void cancel();
+    void wait();
+
+    bool active() const;
+    bool found() const;
+    size_t match();
+    bool counted() const;
+    size_t count() const;
+
+private:
+    //--- private types ---
+    struct Chunk {
+        size_t pos;
+        size_t length;
+        size_t first;
+        size_t count;
+        size_t end;
+        bool done;
+    };
+
+    //--- private methods ---
+    void work();
+    void resolve();
+    void recount(Chunk &chunk, const size_t from);
+
+    //--- private properties ---
+    TextBuffer _buffer;
+    std::string _needle;
+    std::vector<Chunk> _chunks;
+    std::vector<std::thread> _threads;
+    std::mutex _mutex;
+    std::condition_variable _resolved;
+    std::atomic<size_t> _next;
+    std::atomic<size_t> _count;
+    std::atomic<size_t> _pending;
+    std::atomic<size_t> _match;
+    std::atomic<bool> _found;
+    std::atomic<bool> _stop;
+    size_t _first_open;
+    size_t _start_chunk;
+    size_t _count_open;
+    size_t _count_end;
+};
@@ -0,0 +1,236 @@
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include "stats.hxx"
+
+const char *const phase_names[] = {"input", "edit", "draw", "flush", "frame"};
+
+// the width of the histogram bars in the dump
+const size_t bar_width = 50;
+
+static std::atomic<uint64_t> allocation_count{0};
+
+// every allocation of the process is counted, the rest is what the default one does
+void *operator new(size_t size)
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    for (;;)
+    {
+        if (void *memory = std::malloc(size ? size : 1))
+            return memory;
+
+        const std::new_handler handler = std::get_new_handler();
+
+        if (!handler)
+            throw std::bad_alloc();
+        handler();
+    }
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+// a duration in nanoseconds as a short text, switching to larger units while it gets long
+static std::string format(const uint64_t ns)
+{
+    const unsigned long long value = ns;
+    char text[32];
+
+    if (value < 10000000)
+        std::snprintf(text, sizeof (text), "%lluus", value / 1000);
+    else if (value < 10000000000)
+        std::snprintf(text, sizeof (text), "%llums", value / 1000000);
+    else
+        std::snprintf(text, sizeof (text), "%llus", value / 1000000000);
+
+    return text;
+}
+
+//--- public constructors ---
+
+Stats::Stats()
+: _histograms(), _counters()
+{
+}
+
+//--- public methods ---
+
+Stats::Clock::time_point Stats::now()
+{
+    return Clock::now();
+}
+
+uint64_t Stats::allocations()
+{
+    return allocation_count.load(std::memory_order_relaxed);
+}
+
+void Stats::record(const Phase phase, const Clock::time_point start, const Clock::time_point end)
+{
+    Histogram &histogram = _histograms[phase];
+    const uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    const uint64_t us = ns / 1000;
+    const size_t bucket = us ? (64 - __builtin_clzll(us)) : 0;
+
+    ++histogram.buckets[(bucket < bucket_count) ? bucket : (bucket_count - 1)];
+    ++histogram.count;
+    histogram.total += ns;
+    histogram.last = ns;
+    if (ns > histogram.max)
+        histogram.max = ns;
+}
+
+void Stats::count(const Counter counter, const uint64_t amount)
+{
+    _counters[counter] += amount;
+}
+
+const Stats::Histogram &Stats::histogram(const Phase phase) const
+{
+    return _histograms[phase];
+}
+
+uint64_t Stats::counter(const Counter counter) const
+{
+    return _counters[counter];
+}
+
+// the upper end of the bucket holding the sample, so it is exact up to a factor of two, but never
+// above the slowest sample
+uint64_t Stats::percentile(const Phase phase, const uint32_t permille) const
+{
+    const Histogram &histogram = _histograms[phase];
+    const uint64_t rank = (histogram.count * permille + 999) / 1000;
+    uint64_t seen = 0;
+
+    for (size_t bucket = 0; bucket < (bucket_count - 1); ++bucket)
+    {
+        seen += histogram.buckets[bucket];
+        if (seen && (seen >= rank))
+            return std::min<uint64_t>((uint64_t(1) << bucket) * 1000, histogram.max);
+    }
+
+    return histogram.max;
+}
+
+// a few rows small enough to be shown on top of the text, all of the same width
+std::vector<std::string> Stats::overlay() const
+{
+    std::vector<std::string> rows;
+    char row[64];
+
+    std::snprintf(row, sizeof (row), " %-6s %8s %8s %8s %8s ", "", "last", "p50", "p99", "max");
+    rows.push_back(row);
+    for (size_t phase = 0; phase < phase_count; ++phase)
+    {
+        const Histogram &histogram = _histograms[phase];
+
+        std::snprintf(row, sizeof (row), " %-6s %8s %8s %8s %8s ", phase_names[phase],
+                      format(histogram.last).c_str(),
+                      format(percentile(static_cast<Phase>(phase), 500)).c_str(),
+                      format(percentile(static_cast<Phase>(phase), 990)).c_str(),
+                      format(histogram.max).c_str());
+        rows.push_back(row);
+    }
+    std::snprintf(row, sizeof (row), " frames %13llu  keys %15llu ",
+                  static_cast<unsigned long long>(_counters[counter_frames]),
+                  static_cast<unsigned long long>(_counters[counter_keys]));
+    rows.push_back(row);
+    std::snprintf(row, sizeof (row), " rows %15llu  allocations %8llu ",
+                  static_cast<unsigned long long>(_counters[counter_rows]),
+                  static_cast<unsigned long long>(allocations()));
+    rows.push_back(row);
+    std::snprintf(row, sizeof (row), " bytes sent %31llu ",
+                  static_cast<unsigned long long>(_counters[counter_output]));
+    rows.push_back(row);
+
+    return rows;
+}
+
+// the totals, a table of the phases and the histogram of every phase with samples
+bool Stats::dump(const std::string &filename) const
+{
+    std::FILE *file = std::fopen(filename.c_str(), "w");
+
+    if (!file)
+        return false;
+
+    std::fprintf(file, "frames %llu, keys %llu, rows drawn %llu, bytes sent %llu, "
+                 "allocations %llu\n\n",
+                 static_cast<unsigned long long>(_counters[counter_frames]),
+                 static_cast<unsigned long long>(_counters[counter_keys]),
+                 static_cast<unsigned long long>(_counters[counter_rows]),
+                 static_cast<unsigned long long>(_counters[counter_output]),
+                 static_cast<unsigned long long>(allocations()));
+    std::fprintf(file, "%-6s %10s %10s %10s %10s %10s %10s %10s\n", "phase", "samples", "total",
+                 "average", "p50", "p90", "p99", "max");
+    for (size_t phase = 0; phase < phase_count; ++phase)
+    {
+        const Histogram &histogram = _histograms[phase];
+
+        std::fprintf(file, "%-6s %10llu %10s %10s %10s %10s %10s %10s\n", phase_names[phase],
+                     static_cast<unsigned long long>(histogram.count),
+                     format(histogram.total).c_str(),
+                     format(histogram.count ? (histogram.total / histogram.count) : 0).c_str(),
+                     format(percentile(static_cast<Phase>(phase), 500)).c_str(),
+                     format(percentile(static_cast<Phase>(phase), 900)).c_str(),
+                     format(percentile(static_cast<Phase>(phase), 990)).c_str(),
+                     format(histogram.max).c_str());
+    }
+
+    for (size_t phase = 0; phase < phase_count; ++phase)
+    {
+        const Histogram &histogram = _histograms[phase];
+        uint64_t most = 0;
+
+        if (!histogram.count)
+            continue;
+
+        for (size_t bucket = 0; bucket < bucket_count; ++bucket)
+            most = std::max(most, histogram.buckets[bucket]);
+        std::fprintf(file, "\n%s\n", phase_names[phase]);
+        for (size_t bucket = 0; bucket < bucket_count; ++bucket)
+        {
+            if (!histogram.buckets[bucket])
+                continue;
+
+            const std::string bound = (bucket < (bucket_count - 1))
+                                      ? "< " + format((uint64_t(1) << bucket) * 1000)
+                                      : ">= " + format((uint64_t(1) << (bucket - 1)) * 1000);
+
+            std::fprintf(file, "%10s %10llu %s\n", bound.c_str(),
+                         static_cast<unsigned long long>(histogram.buckets[bucket]),
+                         std::string((histogram.buckets[bucket] * bar_width + most - 1) / most,
+                                     '#').c_str());
+        }
+    }
+
+    return (std::fclose(file) == 0);
+}
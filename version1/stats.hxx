@@ -0,0 +1,97 @@
+#pragma once
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Timings and counters of the terminal frontend, to see where the time of a keystroke goes without
+// attaching a profiler. Every phase of a frame is timed with the monotonic clock into a histogram
+// of power of two microsecond buckets, so a sample costs two clock reads and a few increments and
+// allocates nothing. The counters are totals since the start, allocations count every operator new
+// of the process, including the worker threads.
+class Stats {
+public:
+    //--- public constants ---
+    // bucket n takes samples below 2^n microseconds, the last one everything above
+    static constexpr size_t bucket_count = 24;
+
+    //--- public types ---
+    using Clock = std::chrono::steady_clock;
+
+    // reading the keys of a frame, applying them to the buffers, drawing and sending the frame, the
+    // frame itself is timed from its first key on, which is the lag seen when typing
+    enum Phase : uint8_t {
+        phase_input,
+        phase_edit,
+        phase_draw,
+        phase_flush,
+        phase_frame,
+        phase_count
+    };
+
+    // frames drawn, keys applied, rows drawn and bytes sent to the terminal
+    enum Counter : uint8_t {
+        counter_frames,
+        counter_keys,
+        counter_rows,
+        counter_output,
+        counter_count
+    };
+
+    // the samples of a phase, durations in nanoseconds
+    struct Histogram {
+        uint64_t buckets[bucket_count];
+        uint64_t count;
+        uint64_t total;
+        uint64_t last;
+        uint64_t max;
+    };
+
+    //--- public constructors ---
+    Stats();
+    Stats(const Stats &rhs) = delete;
+    Stats(Stats &&rhs) = delete;
+    ~Stats() noexcept = default;
+
+    //--- public operators ---
+    Stats &operator=(const Stats &rhs) = delete;
+    Stats &operator=(Stats &&rhs) = delete;
+
+    //--- public methods ---
+    static Clock::time_point now();
+    static uint64_t allocations();
+
+    void record(const Phase phase, const Clock::time_point start, const Clock::time_point end);
+    void count(const Counter counter, const uint64_t amount = 1);
+
+    const Histogram &histogram(const Phase phase) const;
+    uint64_t counter(const Counter counter) const;
+    uint64_t percentile(const Phase phase, const uint32_t permille) const;
+
+    std::vector<std::string> overlay() const;
+    bool dump(const std::string &filename) const;
+
+private:
+    //--- private properties ---
+    Histogram _histograms[phase_count];
+    uint64_t _counters[counter_count];
+};
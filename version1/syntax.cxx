@@ -0,0 +1,272 @@
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include "syntax.hxx"
+
+const Syntax::Language Syntax::languages[] = {
+    // C and C++
+    {".c .h .cc .cpp .cxx .hh .hpp .hxx", "//", "/*", "*/", "\"'", true,
+     "auto bool break case catch char class const constexpr const_cast continue decltype default "
+     "delete do double dynamic_cast else enum explicit extern false float for friend goto if inline "
+     "int long mutable namespace new noexcept nullptr operator private protected public register "
+     "reinterpret_cast restrict return short signed sizeof static static_assert static_cast struct "
+     "switch template this throw true try typedef typename union unsigned using virtual void "
+     "volatile while"},
+    // Zig
+    {".zig", "//", "", "", "\"'", false,
+     "align allowzero and anyframe anytype asm async await break catch comptime const continue "
+     "defer else enum errdefer error export extern false fn for if inline noalias nosuspend null "
+     "opaque or orelse packed pub resume return struct suspend switch test threadlocal true try "
+     "undefined union unreachable usingnamespace var volatile while"},
+    // Python
+    {".py", "#", "", "", "\"'", false,
+     "and as assert async await break class continue def del elif else except False finally for "
+     "from global if import in is lambda None nonlocal not or pass raise return True try while "
+     "with yield"},
+    // shell scripts
+    {".sh .bash", "#", "", "", "\"'`", false,
+     "case do done elif else esac export fi for function if in local return then until while"},
+    // makefiles
+    {"Makefile makefile GNUmakefile .mk", "#", "", "", "", false,
+     "define else endef endif export ifdef ifeq ifndef ifneq include override"},
+};
+
+static std::vector<std::string> words(const char *list)
+{
+    std::vector<std::string> result;
+
+    for (const char *word = list; *word; )
+    {
+        const size_t length = ::strcspn(word, " ");
+
+        if (length)
+            result.emplace_back(word, length);
+        word += length + (word[length] == ' ');
+    }
+
+    return result;
+}
+
+//--- public constructors ---
+
+Syntax::Syntax()
+: _language(nullptr), _keywords(), _states(), _base(0), _valid(0), _converge(0)
+{
+}
+
+//--- public methods ---
+
+bool Syntax::select(const std::string &filename)
+{
+    const std::string name = filename.substr(filename.rfind('/') + 1);
+
+    _language = nullptr;
+    _keywords.clear();
+    invalidate(0);
+    for (const Language &language : languages)
+    {
+        for (const std::string &file : words(language.files))
+        {
+            const bool matched = (file[0] == '.')
+                                 ? ((name.size() > file.size())
+                                    && !name.compare(name.size() - file.size(), file.size(), file))
+                                 : (name == file);
+
+            if (!matched)
+                continue;
+
+            const std::vector<std::string> keywords = words(language.keywords);
+
+            _language = &language;
+            _keywords.insert(keywords.begin(), keywords.end());
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool Syntax::enabled() const
+{
+    return _language;
+}
+
+size_t Syntax::update(const TextBuffer &buffer, const size_t first, const size_t last)
+{
+    const size_t end = std::min(last, buffer.lines());
+    size_t changed = SIZE_MAX;
+
+    if (!_language || (first >= end))
+        return SIZE_MAX;
+
+    // lines without a known state close by are lexed from some lines in front of them on, the lines
+    // shown may look different then
+    if (_states.empty() || (first < _base) || ((first - _base) >= (_valid + max_lookback)))
+    {
+        _base = (first > max_lookback) ? (first - max_lookback) : 0;
+        _states.assign(1, normal);
+        _valid = 1;
+        _converge = 0;
+        changed = first;
+    }
+
+    // a state behind the edited lines coming out as before means all states behind it are right,
+    // every state coming out different changes how its line looks
+    while ((_base + _valid) < end)
+    {
+        const size_t line = _base + _valid - 1;
+        const State state = lex(buffer, line, _states[_valid - 1], nullptr);
+
+        if (_valid == _states.size())
+            _states.push_back(state);
+        else if ((_states[_valid] == state) && (_valid >= _converge))
+        {
+            _valid = _states.size();
+            _converge = 0;
+            continue;
+        }
+        else if (_states[_valid] != state)
+        {
+            _states[_valid] = state;
+            changed = std::min(changed, line + 1);
+        }
+        ++_valid;
+    }
+
+    return changed;
+}
+
+bool Syntax::tokens(const TextBuffer &buffer, const size_t line, std::vector<Token> &tokens) const
+{
+    tokens.clear();
+    if (!_language || (line < _base) || ((line - _base) >= _valid))
+        return false;
+
+    lex(buffer, line, _states[line - _base], &tokens);
+
+    return true;
+}
+
+void Syntax::edited(const size_t line)
+{
+    // lines in front of the known states do not change them, they start from a guess anyway
+    if ((line < _base) || ((line - _base) >= _states.size()))
+        return;
+
+    _valid = std::min(_valid, line - _base + 1);
+    _converge = std::max(_converge, line - _base + 1);
+}
+
+void Syntax::invalidate(const size_t line)
+{
+    const size_t keep = (line >= _base) ? (line - _base + 1) : 0;
+
+    if (keep < _states.size())
+        _states.resize(keep);
+    _valid = std::min(_valid, keep);
+    _converge = std::min(_converge, keep);
+}
+
+//--- private methods ---
+
+Syntax::State Syntax::lex(const TextBuffer &buffer, const size_t line, State state,
+                          std::vector<Token> *tokens) const
+{
+    const Language &language = *_language;
+    const std::string text = buffer.text(buffer.lineStart(line),
+                                         std::min(buffer.lineLength(line), max_length));
+    const size_t first = text.find_first_not_of(" \t");
+    const Style base = (language.directives && (first != std::string::npos) && (text[first] == '#'))
+                       ? Style::preprocessor : Style::plain;
+    size_t pos = 0;
+
+    // neighboring parts of the same style become one token, plain parts are left out
+    auto emit = [tokens](const size_t offset, const size_t length, const Style style) {
+        if (!tokens || (style == Style::plain))
+            return;
+
+        if (!tokens->empty() && (tokens->back().style == style)
+            && ((tokens->back().offset + tokens->back().length) == offset))
+            tokens->back().length += length;
+        else
+            tokens->push_back({offset, length, style});
+    };
+    auto starts = [&text](const size_t pos, const char *delimiter) {
+        return *delimiter && !text.compare(pos, ::strlen(delimiter), delimiter);
+    };
+    auto word = [](const unsigned char byte) {
+        return std::isalnum(byte) || (byte == '_');
+    };
+
+    // a directive takes the whole line, strings and comments inside of it keep their own style
+    while (pos < text.size())
+    {
+        const size_t start = pos;
+        const unsigned char byte = text[pos];
+
+        if (state == comment)
+        {
+            const size_t end = text.find(language.block_end, pos);
+
+            pos = (end != std::string::npos) ? (end + ::strlen(language.block_end)) : text.size();
+            state = (end != std::string::npos) ? normal : comment;
+            emit(start, pos - start, Style::comment);
+        }
+        else if (starts(pos, language.line_comment))
+        {
+            pos = text.size();
+            emit(start, pos - start, Style::comment);
+        }
+        else if (starts(pos, language.block_begin))
+        {
+            pos += ::strlen(language.block_begin);
+            state = comment;
+            emit(start, pos - start, Style::comment);
+        }
+        else if (byte && ::strchr(language.quotes, byte))
+        {
+            for (++pos; (pos < text.size()) && (static_cast<unsigned char>(text[pos]) != byte); ++pos)
+                pos += ((text[pos] == '\\') && ((pos + 1) < text.size()));
+            pos = std::min(pos + 1, text.size());
+            emit(start, pos - start, Style::string);
+        }
+        else if (std::isdigit(byte))
+        {
+            // prefixes, suffixes and exponents are part of a number
+            while ((pos < text.size()) && (word(text[pos]) || (text[pos] == '.')))
+                ++pos;
+            emit(start, pos - start, Style::number);
+        }
+        else if (word(byte))
+        {
+            while ((pos < text.size()) && word(text[pos]))
+                ++pos;
+            emit(start, pos - start,
+                 ((base == Style::plain) && _keywords.count(text.substr(start, pos - start)))
+                 ? Style::keyword : base);
+        }
+        else
+            emit(start, ++pos - start, base);
+    }
+
+    return state;
+}
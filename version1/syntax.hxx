@@ -0,0 +1,114 @@
+#pragma once
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "textbuffer.hxx"
+
+// Highlighting of source code. Languages are rows of a table: the names of the files they are used
+// for, their comment and string delimiters and their keywords, a single lexer reads all of them. The
+// only state carried from one line to the next is being inside of a block comment, so the state at
+// the start of every line is kept and a line is lexed on its own once the state in front of it is
+// known.
+//
+// Lines are lexed when they are shown, from the last known state on. An edit inside of a line keeps
+// the states behind it and lexing stops as soon as a state behind the edited lines comes out the
+// same as before, edits adding or removing lines drop the states behind them. A line far behind the
+// known states is lexed from some lines in front of it as if no comment was open there, so the cost
+// follows the lines shown and not the size of the file. Only the first max_length bytes of a line
+// are lexed.
+class Syntax {
+public:
+    //--- public types ---
+    enum class Style : uint8_t {
+        plain,
+        keyword,
+        number,
+        string,
+        comment,
+        preprocessor
+    };
+
+    // a part of a line shown in one style, offsets are relative to the line start
+    struct Token {
+        size_t offset;
+        size_t length;
+        Style style;
+    };
+
+    //--- public constants ---
+    static constexpr size_t max_length = 64 * 1024;
+    static constexpr size_t max_lookback = 1024;
+
+    //--- public constructors ---
+    Syntax();
+    Syntax(const Syntax &rhs) = delete;
+    Syntax(Syntax &&rhs) = delete;
+    ~Syntax() noexcept = default;
+
+    //--- public operators ---
+    Syntax &operator=(const Syntax &rhs) = delete;
+    Syntax &operator=(Syntax &&rhs) = delete;
+
+    //--- public methods ---
+    bool select(const std::string &filename);
+    bool enabled() const;
+
+    size_t update(const TextBuffer &buffer, const size_t first, const size_t last);
+    bool tokens(const TextBuffer &buffer, const size_t line, std::vector<Token> &tokens) const;
+    void edited(const size_t line);
+    void invalidate(const size_t line);
+
+private:
+    //--- private types ---
+    // a row of the language table, lists are separated by spaces, file names starting with a '.'
+    // match the end of a name and all others the whole name, empty delimiters are not used
+    struct Language {
+        const char *files;
+        const char *line_comment;
+        const char *block_begin;
+        const char *block_end;
+        const char *quotes;
+        bool directives;
+        const char *keywords;
+    };
+
+    enum State : uint8_t {
+        normal,
+        comment
+    };
+
+    //--- private constants ---
+    static const Language languages[];
+
+    //--- private methods ---
+    State lex(const TextBuffer &buffer, const size_t line, State state,
+              std::vector<Token> *tokens) const;
+
+    //--- private properties ---
+    const Language *_language;
+    std::unordered_set<std::string> _keywords;
+    std::vector<State> _states;
+    size_t _base;
+    size_t _valid;
+    size_t _converge;
+};
@@ -0,0 +1,200 @@
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <ncurses.h>
+#include <unistd.h>
+#include "terminal.hxx"
+
+// bracketed paste markers get their own curses key codes, pasted text is applied as one insert,
+// so do home and end with control held, curses has no codes for them
+const int32_t curses_paste_begin = KEY_MAX + 1;
+const int32_t curses_paste_end = KEY_MAX + 2;
+const int32_t curses_ctrl_home = KEY_MAX + 3;
+const int32_t curses_ctrl_end = KEY_MAX + 4;
+
+// the color pair of a look, the bars keep the pair they always had
+static int16_t pairOf(const Terminal::Look look)
+{
+    const Terminal::Color color = static_cast<Terminal::Color>(look & 0xff);
+
+    return (color == Terminal::color_bar) ? 1 : (color == Terminal::color_text) ? 0 : (color + 2);
+}
+
+static attr_t attrOf(const Terminal::Look look)
+{
+    return ((look & Terminal::bold) ? A_BOLD : A_NORMAL)
+           | ((look & Terminal::reverse) ? A_REVERSE : A_NORMAL);
+}
+
+//--- public constructors ---
+
+Terminal::Terminal()
+: _written(0), _io(::open("/proc/thread-self/io", O_RDONLY | O_CLOEXEC))
+{
+    ::initscr();
+    ::start_color();
+    ::keypad(stdscr, true);
+    ::noecho();
+    ::cbreak();
+    ::raw();
+    ::idlok(stdscr, true);
+    ::set_escdelay(25);
+    ::define_key("\033[200~", curses_paste_begin);
+    ::define_key("\033[201~", curses_paste_end);
+    ::define_key("\033[1;5H", curses_ctrl_home);
+    ::define_key("\033[1;5F", curses_ctrl_end);
+    ::putp("\033[?2004h");
+
+    ::init_pair(1, COLOR_WHITE, COLOR_BLUE);
+
+    // highlighted source code keeps the background of the terminal
+    ::use_default_colors();
+    ::init_pair(3, COLOR_YELLOW, -1);
+    ::init_pair(4, COLOR_RED, -1);
+    ::init_pair(5, COLOR_GREEN, -1);
+    ::init_pair(6, COLOR_CYAN, -1);
+    ::init_pair(7, COLOR_MAGENTA, -1);
+}
+
+Terminal::~Terminal() noexcept
+{
+    ::putp("\033[?2004l");
+    ::endwin();
+    if (_io >= 0)
+        ::close(_io);
+}
+
+//--- public methods ---
+
+int32_t Terminal::rows() const
+{
+    return LINES;
+}
+
+int32_t Terminal::cols() const
+{
+    return COLS;
+}
+
+void Terminal::put(const int32_t row, const int32_t col, const std::string &text, const Look look)
+{
+    ::attrset(attrOf(look) | COLOR_PAIR(pairOf(look)));
+    mvaddnstr(row, col, text.c_str(), text.size());
+    ::attrset(A_NORMAL);
+}
+
+void Terminal::paint(const int32_t row, const int32_t col, const int32_t count, const Look look)
+{
+    mvchgat(row, col, count, attrOf(look), pairOf(look), nullptr);
+}
+
+void Terminal::scrollRows(const int32_t first, const int32_t last, const int32_t count)
+{
+    ::setscrreg(first, last);
+    ::scrollok(stdscr, true);
+    ::scrl(count);
+    ::scrollok(stdscr, false);
+}
+
+void Terminal::cursor(const int32_t row, const int32_t col)
+{
+    ::move(row, col);
+}
+
+void Terminal::flush()
+{
+    const size_t before = threadWritten();
+
+    ::refresh();
+    _written += threadWritten() - before;
+}
+
+int32_t Terminal::read(const int32_t timeout)
+{
+    ::timeout(timeout);
+
+    const int32_t key = ::getch();
+
+    switch (key)
+    {
+        case ERR:
+            return input_none;
+        case KEY_UP:
+            return input_up;
+        case KEY_DOWN:
+            return input_down;
+        case KEY_LEFT:
+            return input_left;
+        case KEY_RIGHT:
+            return input_right;
+        case KEY_HOME:
+            return input_home;
+        case KEY_END:
+            return input_end;
+        case KEY_PPAGE:
+            return input_page_up;
+        case KEY_NPAGE:
+            return input_page_down;
+        case KEY_BACKSPACE:
+            return input_backspace;
+        case KEY_DC:
+            return input_delete;
+        case KEY_ENTER:
+            return '\n';
+        case KEY_RESIZE:
+            return input_resize;
+        case curses_ctrl_home:
+            return input_ctrl_home;
+        case curses_ctrl_end:
+            return input_ctrl_end;
+        case curses_paste_begin:
+            return input_paste_begin;
+        case curses_paste_end:
+            return input_paste_end;
+        default:
+            if ((key >= KEY_F0) && (key <= KEY_F(63)))
+                return input_f0 + (key - KEY_F0);
+            return ((key >= 0) && (key < 256)) ? key : input_none;
+    }
+}
+
+size_t Terminal::written() const
+{
+    return _written;
+}
+
+//--- private methods ---
+
+// all bytes this thread handed to write() so far, refresh() is the only writer in between, without
+// task io accounting in the kernel nothing is counted
+size_t Terminal::threadWritten() const
+{
+    char text[512];
+    const ssize_t length = (_io >= 0) ? ::pread(_io, text, sizeof (text) - 1, 0) : -1;
+
+    if (length <= 0)
+        return 0;
+    text[length] = '\0';
+
+    const char *wchar = std::strstr(text, "wchar: ");
+
+    return wchar ? std::strtoull(wchar + 7, nullptr, 10) : 0;
+}
@@ -0,0 +1,134 @@
+#pragma once
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// The terminal the screen draws on: rows of cells with a look each, a cursor and the keys typed. The
+// look of a cell is a color and flags, the colors of source code follow Syntax::Style. What is drawn
+// only shows up on flush().
+//
+// The terminal is chosen at build time. The default one uses ncurses (terminal.cxx). The raw one
+// (rawterminal.cxx) needs nothing but termios: it keeps the cells it wrote and the ones drawn since,
+// compares them on flush() and sends the escape sequences for the changed cells in a single write.
+// It can be built without ncurses, for example as a static binary. The raw one counts the bytes it
+// sends itself, ncurses writes to the file descriptor of the terminal on its own, so the curses one
+// takes them from the write counter the kernel keeps for the drawing thread.
+class Terminal {
+public:
+    //--- public types ---
+    // keys besides characters, which are their own code, function key n is input_f0 + n
+    enum Input : int32_t {
+        input_none = -1,
+        input_up = 256,
+        input_down,
+        input_left,
+        input_right,
+        input_home,
+        input_end,
+        input_page_up,
+        input_page_down,
+        input_backspace,
+        input_delete,
+        input_ctrl_home,
+        input_ctrl_end,
+        input_paste_begin,
+        input_paste_end,
+        input_resize,
+        input_f0
+    };
+
+    enum Color : uint8_t {
+        color_text,
+        color_keyword,
+        color_number,
+        color_string,
+        color_comment,
+        color_preprocessor,
+        color_bar
+    };
+
+    // a color in the low byte and flags above it
+    using Look = uint16_t;
+
+    //--- public constants ---
+    static constexpr Look bold = 0x100;
+    static constexpr Look reverse = 0x200;
+
+    //--- public constructors ---
+    Terminal();
+    Terminal(const Terminal &rhs) = delete;
+    Terminal(Terminal &&rhs) = delete;
+    ~Terminal() noexcept;
+
+    //--- public operators ---
+    Terminal &operator=(const Terminal &rhs) = delete;
+    Terminal &operator=(Terminal &&rhs) = delete;
+
+    //--- public methods ---
+    int32_t rows() const;
+    int32_t cols() const;
+    void put(const int32_t row, const int32_t col, const std::string &text,
+             const Look look = color_text);
+    void paint(const int32_t row, const int32_t col, const int32_t count, const Look look);
+    void scrollRows(const int32_t first, const int32_t last, const int32_t count);
+    void cursor(const int32_t row, const int32_t col);
+    void flush();
+    int32_t read(const int32_t timeout);
+    size_t written() const;
+
+private:
+#if RAW_TERMINAL
+    //--- private types ---
+    // a column of the screen, the second column of a wide character has no text
+    struct Cell {
+        std::string text;
+        Look look;
+
+        bool operator==(const Cell &rhs) const;
+        bool operator!=(const Cell &rhs) const;
+    };
+
+    //--- private methods ---
+    bool skip(const Cell *cells, const int32_t from, const int32_t to, const int32_t look);
+    void measure();
+    bool fill(const int32_t timeout);
+    int32_t decode(size_t &length) const;
+
+    //--- private properties ---
+    std::vector<Cell> _cells;
+    std::vector<Cell> _shown;
+    std::string _output;
+    std::string _input;
+    size_t _written;
+    int32_t _rows;
+    int32_t _cols;
+    int32_t _row;
+    int32_t _col;
+#else
+    //--- private methods ---
+    size_t threadWritten() const;
+
+    //--- private properties ---
+    size_t _written;
+    int32_t _io;
+#endif
+};
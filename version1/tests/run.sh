@@ -0,0 +1,41 @@
+#!/bin/sh
+#
+#  Watte - weird and trivially tiny editor
+#  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+#
+#  This program is free software: you can redistribute it and/or modify
+#  it under the terms of the GNU General Public License as published by
+#  the Free Software Foundation, either version 3 of the License, or
+#  (at your option) any later version.
+#
+#  This program is distributed in the hope that it will be useful,
+#  but WITHOUT ANY WARRANTY; without even the implied warranty of
+#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#  GNU General Public License for more details.
+#
+#  You should have received a copy of the GNU General Public License
+#  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+# Runs every batch script next to this file on a new file and compares what it writes to stdout
+# with the .out file of the same name. Usage: run.sh <watte binary>
+
+watte=$(realpath "$1") || exit 1
+tests=$(dirname "$0")
+work=$(mktemp -d) || exit 1
+failed=0
+
+for script in "$tests"/*.batch; do
+    name=$(basename "$script" .batch)
+
+    if "$watte" -b "$script" "$work/$name.txt" > "$work/$name.res" 2>&1 \
+       && cmp -s "$work/$name.res" "$tests/$name.out"; then
+        echo "pass $name"
+    else
+        echo "FAIL $name"
+        diff "$tests/$name.out" "$work/$name.res"
+        failed=1
+    fi
+done
+
+rm -rf "$work"
+exit $failed
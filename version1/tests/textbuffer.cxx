@@ -0,0 +1,107 @@
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "textbuffer.hxx"
+
+// Checks the line index of a mapped file against the lines of the same text held in a string, after
+// every step of indexing it. Lines of random length make pieces end anywhere in a line, right in
+// front of a line feed and right behind it. Prints the first mismatch and fails.
+
+static size_t failures = 0;
+
+static void expect(const bool result, const char *what, const size_t line, const size_t value,
+                   const size_t expected)
+{
+    if (result || (failures++ > 10))
+        return;
+    std::printf("%s of line %zu is %zu, expected %zu\n", what, line, value, expected);
+}
+
+static void check(const TextBuffer &buffer, const std::string &text,
+                  const std::vector<size_t> &starts)
+{
+    const size_t lines = buffer.lines();
+
+    // every line reported is complete, the one behind them only has its indexed part
+    for (size_t line = 0; line <= lines; ++line)
+    {
+        if ((line == lines) && buffer.complete())
+            break;
+
+        const size_t start = buffer.lineStart(line);
+        const size_t end = (line + 1) < starts.size() ? (starts[line + 1] - 1) : text.size();
+        const size_t length = buffer.lineLength(line);
+
+        expect(start == starts[line], "start", line, start, starts[line]);
+        if (line < lines)
+            expect(length == (end - starts[line]), "length", line, length, end - starts[line]);
+        else
+            expect(length == (buffer.size() - start), "partial length", line, length,
+                   buffer.size() - start);
+        if (length)
+            expect(buffer.lineOf(start + length - 1) == line, "line of the end", line,
+                   buffer.lineOf(start + length - 1), line);
+    }
+}
+
+int32_t main()
+{
+    std::mt19937 random(1);
+    std::string text;
+    std::vector<size_t> starts = {0};
+    char filename[] = "/tmp/watte-textbuffer-XXXXXX";
+    const int32_t fd = ::mkstemp(filename);
+    TextBuffer buffer;
+
+    // a few pieces of short and long lines, the file ends with the line feed the buffer leaves out
+    while (text.size() < (TextBuffer::max_piece * 5))
+    {
+        text.append(random() % ((random() % 8) ? 80 : 5000), 'x');
+        text += '\n';
+        starts.push_back(text.size());
+    }
+    text.pop_back();
+    starts.pop_back();
+
+    if ((fd < 0) || (::write(fd, text.data(), text.size()) != static_cast<ssize_t>(text.size()))
+        || (::write(fd, "\n", 1) != 1) || !buffer.load(filename))
+    {
+        std::printf("cannot write %s\n", filename);
+        return 1;
+    }
+    ::close(fd);
+    ::unlink(filename);
+
+    // indexLines moves single pieces into the tree, far enough for the line asked for
+    check(buffer, text, starts);
+    while (!buffer.complete())
+    {
+        buffer.indexLines(buffer.lines() + (random() % 3));
+        check(buffer, text, starts);
+    }
+    expect(buffer.lines() == starts.size(), "count", 0, buffer.lines(), starts.size());
+
+    std::printf("%s textbuffer\n", failures ? "FAIL" : "pass");
+
+    return failures ? 1 : 0;
+}
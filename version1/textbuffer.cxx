@@ -0,0 +1,805 @@
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "linescan.h"
+#include "memsearch.h"
+#include "textbuffer.hxx"
+
+//--- public constructors ---
+
+TextBuffer::TextBuffer()
+: _storage(std::make_shared<Storage>()), _root(), _tail(nullptr), _tail_size(0),
+  _seed(0x9e3779b9)
+{
+}
+
+TextBuffer::Mapping::~Mapping() noexcept
+{
+    if (data)
+        ::munmap(data, size);
+    if (fd >= 0)
+        ::close(fd);
+}
+
+//--- public methods ---
+
+bool TextBuffer::load(const std::string &filename)
+{
+    std::shared_ptr<const Mapping> mapping = mapFile(filename);
+
+    if (!mapping)
+        return false;
+
+    _storage = std::make_shared<Storage>();
+    _storage->mapping = std::move(mapping);
+    _root.reset();
+    _tail = static_cast<const char *>(_storage->mapping->data);
+    _tail_size = _storage->mapping->size;
+
+    // the last line terminator is implied, saving writes it back
+    if (_tail_size && (_tail[_tail_size - 1] == '\n'))
+        --_tail_size;
+
+    return true;
+}
+
+void TextBuffer::assign(std::string &&content)
+{
+    _storage = std::make_shared<Storage>();
+    _storage->original = std::move(content);
+    _root = buildPieces(_storage->original.data(), _storage->original.size());
+    _tail = nullptr;
+    _tail_size = 0;
+}
+
+void TextBuffer::clear()
+{
+    _storage = std::make_shared<Storage>();
+    _root.reset();
+    _tail = nullptr;
+    _tail_size = 0;
+}
+
+bool TextBuffer::complete() const
+{
+    return !_tail_size;
+}
+
+size_t TextBuffer::index(size_t bytes)
+{
+    indexTail(bytes, true);
+
+    return _tail_size;
+}
+
+void TextBuffer::indexLines(size_t lines)
+{
+    while (_tail_size && (this->lines() <= lines))
+        indexTail(max_piece, false);
+}
+
+void TextBuffer::indexCounted(const uint32_t *counts, size_t pieces)
+{
+    indexTail(std::min(pieces, SIZE_MAX / max_piece) * max_piece, true, counts);
+}
+
+const char *TextBuffer::tail() const
+{
+    return _tail;
+}
+
+size_t TextBuffer::unindexed() const
+{
+    return _tail_size;
+}
+
+void TextBuffer::release()
+{
+    const Mapping *mapping = _storage->mapping.get();
+
+    // the mapping is never written, dropped pages are read back from the file once they are needed
+    if (mapping && mapping->data)
+        ::madvise(mapping->data, mapping->size, MADV_DONTNEED);
+}
+
+size_t TextBuffer::size() const
+{
+    return _root ? _root->bytes : 0;
+}
+
+size_t TextBuffer::lines() const
+{
+    const size_t lfs = _root ? _root->lines : 0;
+
+    // the last line is only known to be complete once the whole tail is indexed
+    return _tail_size ? lfs : (lfs + 1);
+}
+
+size_t TextBuffer::lineStart(size_t line) const
+{
+    const Node *node = _root.get();
+    size_t offset = 0;
+
+    if (!line)
+        return 0;
+
+    // descend to the piece holding the line feed that ends the previous line
+    while (node)
+    {
+        const size_t left_lines = node->left ? node->left->lines : 0;
+        const size_t left_bytes = node->left ? node->left->bytes : 0;
+
+        if (line <= left_lines)
+        {
+            node = node->left.get();
+            continue;
+        }
+
+        line -= left_lines;
+        offset += left_bytes;
+        if (line <= node->lfs)
+            return offset + ::linescan_nth(node->data, node->length, line) + 1;
+
+        line -= node->lfs;
+        offset += node->length;
+        node = node->right.get();
+    }
+
+    return offset;
+}
+
+size_t TextBuffer::lineLength(size_t line) const
+{
+    const size_t start = lineStart(line);
+
+    // only the line behind the last indexed line feed runs up to the end, a partly indexed file
+    // ends with a line feed whose line is complete
+    if (line >= (_root ? _root->lines : 0))
+        return size() - start;
+
+    return lineStart(line + 1) - start - 1;
+}
+
+size_t TextBuffer::lineOf(size_t pos) const
+{
+    const Node *node = _root.get();
+    size_t line = 0;
+
+    while (node)
+    {
+        const size_t left_bytes = node->left ? node->left->bytes : 0;
+
+        if (pos < left_bytes)
+        {
+            node = node->left.get();
+            continue;
+        }
+
+        line += node->left ? node->left->lines : 0;
+        pos -= left_bytes;
+        if (pos < node->length)
+            return line + ::linescan_count(node->data, pos);
+
+        line += node->lfs;
+        pos -= node->length;
+        node = node->right.get();
+    }
+
+    return line;
+}
+
+void TextBuffer::insert(size_t pos, const char *data, size_t length)
+{
+    if (!length)
+        return;
+
+    auto [lhs, rhs] = split(_root, std::min(pos, size()));
+    NodePtr middle;
+    Storage &storage = *_storage;
+
+    while (length)
+    {
+        if (storage.used == block_size)
+        {
+            storage.blocks.emplace_back(new char[block_size]);
+            storage.used = 0;
+        }
+
+        const size_t count = std::min({length, block_size - storage.used, max_piece});
+        char *dest = storage.blocks.back().get() + storage.used;
+
+        std::memcpy(dest, data, count);
+        storage.used += count;
+
+        const size_t lfs = ::linescan_count(dest, count);
+
+        // consecutive typing lands right behind the previous insert in the same block
+        NodePtr extended;
+
+        if (!middle && (dest != storage.blocks.back().get()))
+            extended = extendLast(lhs, dest, count, lfs);
+
+        if (extended)
+            lhs = std::move(extended);
+        else
+            middle = merge(middle, makeNode(dest, count, lfs, nextPriority(), nullptr,
+                                            nullptr));
+
+        data += count;
+        length -= count;
+    }
+
+    _root = merge(merge(lhs, middle), rhs);
+}
+
+void TextBuffer::insert(size_t pos, const std::string &str)
+{
+    insert(pos, str.data(), str.size());
+}
+
+void TextBuffer::insert(size_t pos, const Span &span)
+{
+    if (!span._root)
+        return;
+
+    auto [lhs, rhs] = split(_root, std::min(pos, size()));
+
+    _root = merge(merge(lhs, span._root), rhs);
+}
+
+TextBuffer::Span TextBuffer::erase(size_t pos, size_t length)
+{
+    Span removed;
+
+    if (!length || (pos >= size()))
+        return removed;
+
+    auto [lhs, rest] = split(_root, pos);
+    auto [middle, rhs] = split(rest, length);
+
+    removed._root = std::move(middle);
+    _root = merge(lhs, rhs);
+
+    return removed;
+}
+
+void TextBuffer::replace(const std::vector<Range> &ranges, const std::string &str)
+{
+    if (ranges.empty())
+        return;
+
+    // the ranges may reach into the tail
+    indexTail(SIZE_MAX, true);
+
+    // more replacements than pieces would mostly leave tiny pieces behind, the content is written
+    // anew into blocks of its own then, otherwise the buffer is split and merged again in a single
+    // pass from the front to the back, the replacement is stored once and every range gets its own
+    // pieces of it
+    if (ranges.size() > (size() / max_piece))
+    {
+        rewrite(ranges, str);
+        return;
+    }
+
+    std::vector<size_t> lfs;
+    char *data = nullptr;
+
+    if (!str.empty())
+    {
+        data = addBlock(str.size());
+        std::memcpy(data, str.data(), str.size());
+        for (size_t offset = 0; offset < str.size(); offset += max_piece)
+            lfs.push_back(::linescan_count(data + offset, std::min(max_piece, str.size() - offset)));
+    }
+
+    NodePtr result;
+    NodePtr rest = _root;
+    size_t done = 0;
+
+    for (const Range &range : ranges)
+    {
+        auto [lhs, rhs] = split(rest, range.pos - done);
+
+        result = merge(result, lhs);
+        rest = split(rhs, range.length).second;
+        done = range.pos + range.length;
+        for (size_t offset = 0; offset < str.size(); offset += max_piece)
+            result = merge(result, makeNode(data + offset, std::min(max_piece, str.size() - offset),
+                                            lfs[offset / max_piece], nextPriority(), nullptr,
+                                            nullptr));
+    }
+
+    _root = merge(result, rest);
+}
+
+TextBuffer::Span TextBuffer::slice(size_t pos, size_t length) const
+{
+    Span span;
+
+    if (length && (pos < size()))
+        span._root = split(split(_root, pos).second, length).first;
+
+    return span;
+}
+
+TextBuffer::Span TextBuffer::concat(const Span &lhs, const Span &rhs) const
+{
+    Span span;
+
+    span._root = merge(lhs._root, rhs._root);
+
+    return span;
+}
+
+std::string TextBuffer::text(size_t pos, size_t length) const
+{
+    std::string result;
+
+    forEachSpan(pos, length, [&result](const char *data, size_t count) {
+        result.append(data, count);
+        return true;
+    });
+
+    return result;
+}
+
+bool TextBuffer::forEachSpan(size_t pos, size_t length, const SpanFunc &func) const
+{
+    const size_t indexed = size();
+
+    if (pos < indexed)
+    {
+        const size_t count = std::min(length, indexed - pos);
+
+        if (!walk(_root, pos, count, func))
+            return false;
+        pos += count;
+        length -= count;
+    }
+
+    // the unindexed tail continues right behind the tree
+    if (!length || ((pos - indexed) >= _tail_size))
+        return true;
+
+    return func(_tail + (pos - indexed), std::min(length, _tail_size - (pos - indexed)));
+}
+
+bool TextBuffer::forEachSpan(const SpanFunc &func) const
+{
+    return forEachSpan(0, SIZE_MAX, func);
+}
+
+size_t TextBuffer::find(const std::string &needle, size_t pos) const
+{
+    size_t result = SIZE_MAX;
+
+    forEachMatch(needle, pos, SIZE_MAX, [&result](size_t match) {
+        result = match;
+        return false;
+    });
+
+    return result;
+}
+
+bool TextBuffer::forEachMatch(const std::string &needle, size_t pos, size_t length,
+                              const MatchFunc &func) const
+{
+    const size_t carry_size = needle.size() ? (needle.size() - 1) : 0;
+    const size_t end = (length > (SIZE_MAX - pos)) ? SIZE_MAX : (pos + length);
+    bool result = true;
+    std::string carry;
+
+    if (needle.empty())
+        return true;
+
+    // matches starting in the range, report every one and stop when the receiver does not want more
+    const auto report = [&](const char *data, size_t size, size_t base, size_t limit) {
+        for (size_t offset = 0; (offset + needle.size()) <= size;)
+        {
+            const ssize_t hit = ::memsearch_find(data + offset, size - offset, needle.data(),
+                                                 needle.size());
+
+            if ((hit < 0) || ((offset + hit) >= limit) || ((base + offset + hit) >= end))
+                return (hit < 0) || ((offset + hit) >= limit);
+            if (!func(base + offset + hit))
+            {
+                result = false;
+                return false;
+            }
+            offset += hit + 1;
+        }
+
+        return true;
+    };
+
+    // the spans are searched where they are, only the bytes around piece borders are copied to find
+    // matches crossing them
+    forEachSpan(pos, (end == SIZE_MAX) ? SIZE_MAX : (length + carry_size), [&](const char *data,
+                                                                            size_t count) {
+        if (!carry.empty())
+        {
+            const std::string border = carry + std::string(data, std::min(count, carry_size));
+
+            if (!report(border.data(), border.size(), pos - carry.size(), carry.size()))
+                return false;
+        }
+
+        if (!report(data, count, pos, SIZE_MAX))
+            return false;
+
+        if (count >= carry_size)
+            carry.assign(data + count - carry_size, carry_size);
+        else
+        {
+            carry.append(data, count);
+            carry.erase(0, carry.size() - std::min(carry.size(), carry_size));
+        }
+        pos += count;
+
+        return true;
+    });
+
+    return result;
+}
+
+TextBuffer::Source TextBuffer::source() const
+{
+    const Mapping *mapping = _storage->mapping.get();
+
+    if (!mapping)
+        return {-1, nullptr, 0};
+
+    return {mapping->fd, static_cast<const char *>(mapping->data), mapping->size};
+}
+
+//--- private methods ---
+
+std::shared_ptr<const TextBuffer::Mapping> TextBuffer::mapFile(const std::string &filename)
+{
+    // mappings in use by device, inode, size and modification time, a file saved in the meantime
+    // is a new inode and gets mapped again
+    static std::mutex mutex;
+    static std::map<std::tuple<uint64_t, uint64_t, uint64_t, int64_t>,
+                    std::weak_ptr<const Mapping>> mappings;
+    const int32_t fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st;
+
+    if (fd < 0)
+        return nullptr;
+
+    if ((::fstat(fd, &st) < 0) || !S_ISREG(st.st_mode))
+    {
+        ::close(fd);
+        return nullptr;
+    }
+
+    const std::tuple<uint64_t, uint64_t, uint64_t, int64_t> key(st.st_dev, st.st_ino, st.st_size,
+                                                                st.st_mtime);
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (auto it = mappings.begin(); it != mappings.end();)
+        it = it->second.expired() ? mappings.erase(it) : std::next(it);
+    if (const auto it = mappings.find(key); it != mappings.end())
+    {
+        if (std::shared_ptr<const Mapping> shared = it->second.lock())
+        {
+            ::close(fd);
+            return shared;
+        }
+    }
+
+    auto mapping = std::make_shared<Mapping>();
+
+    // the descriptor stays open for the lifetime of the mapping, saving copies from it
+    mapping->fd = fd;
+    if (st.st_size > 0)
+    {
+        void *data = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (data == MAP_FAILED)
+            return nullptr;
+        mapping->data = data;
+        mapping->size = st.st_size;
+    }
+    mappings[key] = mapping;
+
+    return mapping;
+}
+
+uint32_t TextBuffer::nextPriority()
+{
+    _seed ^= _seed << 13;
+    _seed ^= _seed >> 17;
+    _seed ^= _seed << 5;
+
+    return _seed;
+}
+
+TextBuffer::NodePtr TextBuffer::makeNode(const char *data, size_t length, size_t lfs,
+                                         uint32_t priority, NodePtr left, NodePtr right) const
+{
+    const uint64_t bytes = length + (left ? left->bytes : 0) + (right ? right->bytes : 0);
+    const uint64_t lines = lfs + (left ? left->lines : 0) + (right ? right->lines : 0);
+    const uint32_t pieces = 1 + (left ? left->pieces : 0) + (right ? right->pieces : 0);
+
+    return std::make_shared<const Node>(Node{data, static_cast<uint32_t>(length),
+                                             static_cast<uint32_t>(lfs), priority, pieces, bytes,
+                                             lines, std::move(left), std::move(right)});
+}
+
+TextBuffer::NodePtr TextBuffer::merge(const NodePtr &lhs, const NodePtr &rhs) const
+{
+    if (!lhs)
+        return rhs;
+    if (!rhs)
+        return lhs;
+
+    if (lhs->priority >= rhs->priority)
+        return makeNode(lhs->data, lhs->length, lhs->lfs, lhs->priority, lhs->left,
+                        merge(lhs->right, rhs));
+
+    return makeNode(rhs->data, rhs->length, rhs->lfs, rhs->priority, merge(lhs, rhs->left),
+                    rhs->right);
+}
+
+std::pair<TextBuffer::NodePtr, TextBuffer::NodePtr> TextBuffer::split(const NodePtr &node,
+                                                                      size_t pos) const
+{
+    if (!node || !pos)
+        return {nullptr, node};
+    if (pos >= node->bytes)
+        return {node, nullptr};
+
+    const size_t left_bytes = node->left ? node->left->bytes : 0;
+
+    if (pos <= left_bytes)
+    {
+        auto [lhs, rhs] = split(node->left, pos);
+
+        return {lhs, makeNode(node->data, node->length, node->lfs, node->priority, rhs,
+                              node->right)};
+    }
+
+    if (pos >= (left_bytes + node->length))
+    {
+        auto [lhs, rhs] = split(node->right, pos - left_bytes - node->length);
+
+        return {makeNode(node->data, node->length, node->lfs, node->priority, node->left, lhs),
+                rhs};
+    }
+
+    // the split position is inside of this piece, both halves keep the priority of the piece
+    const size_t offset = pos - left_bytes;
+    const size_t lfs = ::linescan_count(node->data, offset);
+
+    return {makeNode(node->data, offset, lfs, node->priority, node->left, nullptr),
+            makeNode(node->data + offset, node->length - offset, node->lfs - lfs, node->priority,
+                     nullptr, node->right)};
+}
+
+TextBuffer::NodePtr TextBuffer::extendLast(const NodePtr &node, const char *end, size_t length,
+                                           size_t lfs) const
+{
+    if (!node)
+        return nullptr;
+
+    if (node->right)
+    {
+        NodePtr right = extendLast(node->right, end, length, lfs);
+
+        if (!right)
+            return nullptr;
+
+        return makeNode(node->data, node->length, node->lfs, node->priority, node->left,
+                        std::move(right));
+    }
+
+    if (((node->data + node->length) != end) || ((node->length + length) > max_piece))
+        return nullptr;
+
+    return makeNode(node->data, node->length + length, node->lfs + lfs, node->priority,
+                    node->left, nullptr);
+}
+
+TextBuffer::NodePtr TextBuffer::buildPieces(const char *data, size_t length,
+                                            const uint32_t *counts)
+{
+    NodePtr root;
+
+    // line feeds counted ahead of time are given for every piece
+    for (size_t offset = 0; offset < length; offset += max_piece)
+    {
+        const size_t count = std::min(max_piece, length - offset);
+        const size_t lfs = counts ? counts[offset / max_piece]
+                                  : ::linescan_count(data + offset, count);
+
+        root = merge(root, makeNode(data + offset, count, lfs, nextPriority(), nullptr, nullptr));
+    }
+
+    return root;
+}
+
+void TextBuffer::indexTail(size_t bytes, bool release, const uint32_t *counts)
+{
+    const size_t count = std::min(bytes, _tail_size);
+
+    if (!count)
+        return;
+
+    _root = merge(_root, buildPieces(_tail, count, counts));
+
+    // scanned pages are dropped from the mapping, they are read back from the file when shown
+    if (release)
+    {
+        const uintptr_t page = ::sysconf(_SC_PAGESIZE);
+        const uintptr_t start = (reinterpret_cast<uintptr_t>(_tail) + page - 1) & ~(page - 1);
+        const uintptr_t end = (reinterpret_cast<uintptr_t>(_tail) + count) & ~(page - 1);
+
+        if (start < end)
+            ::madvise(reinterpret_cast<void *>(start), end - start, MADV_DONTNEED);
+    }
+
+    _tail += count;
+    _tail_size -= count;
+}
+
+char *TextBuffer::addBlock(size_t size)
+{
+    Storage &storage = *_storage;
+    std::unique_ptr<char[]> block(new char[size]);
+    char *data = block.get();
+
+    // the last block stays the one inserts fill up
+    if (storage.used == block_size)
+        storage.blocks.push_back(std::move(block));
+    else
+        storage.blocks.insert(storage.blocks.end() - 1, std::move(block));
+
+    return data;
+}
+
+void TextBuffer::rewrite(const std::vector<Range> &ranges, const std::string &str)
+{
+    auto range = ranges.begin();
+    NodePtr root;
+    char *block = nullptr;
+    size_t used = block_size;
+    size_t pos = 0;
+    size_t skip = 0;
+
+    // the kept parts and the replacements are copied behind each other, every full block becomes
+    // pieces right away
+    const auto append = [&](const char *data, size_t length) {
+        while (length)
+        {
+            if (used == block_size)
+            {
+                if (block)
+                    root = merge(root, buildPieces(block, used));
+                block = addBlock(block_size);
+                used = 0;
+            }
+
+            const size_t count = std::min(length, block_size - used);
+
+            std::memcpy(block + used, data, count);
+            used += count;
+            data += count;
+            length -= count;
+        }
+
+        return true;
+    };
+
+    // a replacement goes where its range starts, the range itself is skipped
+    forEachSpan([&](const char *data, size_t length) {
+        while (length)
+        {
+            size_t count;
+
+            if (skip)
+                count = std::min(skip, length);
+            else if ((range != ranges.end()) && (range->pos == pos))
+            {
+                append(str.data(), str.size());
+                skip = (range++)->length;
+                continue;
+            }
+            else
+            {
+                count = std::min(length, ((range != ranges.end()) ? range->pos : SIZE_MAX) - pos);
+                append(data, count);
+            }
+            skip -= std::min(skip, count);
+            pos += count;
+            data += count;
+            length -= count;
+        }
+
+        return true;
+    });
+
+    // empty ranges at the very end
+    for (; range != ranges.end(); ++range)
+        append(str.data(), str.size());
+    if (block)
+        root = merge(root, buildPieces(block, used));
+
+    _root = std::move(root);
+}
+
+bool TextBuffer::walk(const NodePtr &node, size_t pos, size_t length, const SpanFunc &func) const
+{
+    if (!node || !length)
+        return true;
+
+    const size_t left_bytes = node->left ? node->left->bytes : 0;
+
+    if (pos < left_bytes)
+    {
+        const size_t count = std::min(length, left_bytes - pos);
+
+        if (!walk(node->left, pos, count, func))
+            return false;
+        pos += count;
+        length -= count;
+    }
+
+    if (length && (pos < (left_bytes + node->length)))
+    {
+        const size_t offset = pos - left_bytes;
+        const size_t count = std::min<size_t>(length, node->length - offset);
+
+        if (!func(node->data + offset, count))
+            return false;
+        pos += count;
+        length -= count;
+    }
+
+    if (!length)
+        return true;
+
+    return walk(node->right, pos - left_bytes - node->length, length, func);
+}
+
+//--- span methods ---
+
+size_t TextBuffer::Span::size() const
+{
+    return _root ? _root->bytes : 0;
+}
+
+size_t TextBuffer::Span::lines() const
+{
+    return _root ? _root->lines : 0;
+}
+
+size_t TextBuffer::Span::memory() const
+{
+    // every piece is a node shared with its control block, the text itself is in the storage
+    return _root ? (_root->pieces * (sizeof (Node) + 2 * sizeof (void *))) : 0;
+}
@@ -0,0 +1,185 @@
+#pragma once
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// The text buffer is a piece table: the document is a sequence of pieces, each one pointing
+// into either the original file content or an append-only add buffer. The pieces are kept in
+// an implicit treap ordered by document position, so inserting and erasing anywhere costs
+// O(log n) and no line is ever stored as its own heap object. Every node also counts the line
+// feeds of its subtree, which makes the tree a line index: line number to byte offset and byte
+// offset to line number are O(log n) lookups and stay up to date with every edit. Tree nodes are
+// immutable and shared, every modification only copies the path from the root to the changed
+// pieces.
+//
+// Files are mapped read-only instead of being read. The mapped content starts out as an unindexed
+// tail behind the tree and is moved into the tree piece by piece once its line feeds are counted,
+// either on demand (indexLines) or in the background (index). The tail is always taken in pieces
+// starting at multiples of max_piece, so their line feeds may as well be counted elsewhere ahead of
+// time and handed in (indexCounted). Until then lines() only reports the complete lines of the
+// indexed part. Reading the content (forEachSpan, text, find) covers the tail as well.
+//
+// Copies are cheap snapshots, they share the tree and the backing memory with the original. Shared
+// memory is never modified, so a copy can be read on another thread while the original is edited.
+// Buffers loading the same unchanged file share its mapping as well, each one only adds its edits.
+class TextBuffer {
+public:
+    //--- public types ---
+    class Span;
+    using SpanFunc = std::function<bool(const char *data, size_t length)>;
+    using MatchFunc = std::function<bool(size_t pos)>;
+
+    // a part of the content, from pos up to pos + length, replace() takes them ordered and not
+    // overlapping
+    struct Range {
+        size_t pos;
+        size_t length;
+    };
+
+    // the mapped file, pieces pointing into it can be copied by the kernel when saving
+    struct Source {
+        int32_t fd;
+        const char *data;
+        size_t size;
+    };
+
+    //--- public constants ---
+    static constexpr size_t max_piece = 64 * 1024;
+    static constexpr size_t block_size = 1024 * 1024;
+    static constexpr size_t index_step = 16 * 1024 * 1024;
+
+    //--- public constructors ---
+    TextBuffer();
+    TextBuffer(const TextBuffer &rhs) = default;
+    TextBuffer(TextBuffer &&rhs) = default;
+    ~TextBuffer() noexcept = default;
+
+    //--- public operators ---
+    TextBuffer &operator=(const TextBuffer &rhs) = default;
+    TextBuffer &operator=(TextBuffer &&rhs) = default;
+
+    //--- public methods ---
+    bool load(const std::string &filename);
+    void assign(std::string &&content);
+    void clear();
+
+    bool complete() const;
+    size_t index(size_t bytes = SIZE_MAX);
+    void indexLines(size_t lines);
+    void indexCounted(const uint32_t *counts, size_t pieces);
+    const char *tail() const;
+    size_t unindexed() const;
+    void release();
+
+    size_t size() const;
+    size_t lines() const;
+    size_t lineStart(size_t line) const;
+    size_t lineLength(size_t line) const;
+    size_t lineOf(size_t pos) const;
+
+    void insert(size_t pos, const char *data, size_t length);
+    void insert(size_t pos, const std::string &str);
+    void insert(size_t pos, const Span &span);
+    Span erase(size_t pos, size_t length);
+    void replace(const std::vector<Range> &ranges, const std::string &str);
+    Span slice(size_t pos, size_t length) const;
+    Span concat(const Span &lhs, const Span &rhs) const;
+
+    std::string text(size_t pos, size_t length) const;
+    bool forEachSpan(size_t pos, size_t length, const SpanFunc &func) const;
+    bool forEachSpan(const SpanFunc &func) const;
+    size_t find(const std::string &needle, size_t pos = 0) const;
+    bool forEachMatch(const std::string &needle, size_t pos, size_t length,
+                      const MatchFunc &func) const;
+    Source source() const;
+
+private:
+    //--- private types ---
+    struct Node;
+    using NodePtr = std::shared_ptr<const Node>;
+
+    struct Node {
+        const char *data;
+        uint32_t length;
+        uint32_t lfs;
+        uint32_t priority;
+        uint32_t pieces;
+        uint64_t bytes;
+        uint64_t lines;
+        NodePtr left;
+        NodePtr right;
+    };
+
+    // a mapped file, the same file is mapped once as long as it does not change on disk
+    struct Mapping {
+        int32_t fd = -1;
+        void *data = nullptr;
+        size_t size = 0;
+
+        ~Mapping() noexcept;
+    };
+
+    // backing memory of all pieces, never modified once written and only released as a whole
+    struct Storage {
+        std::string original;
+        std::shared_ptr<const Mapping> mapping;
+        std::vector<std::unique_ptr<char[]>> blocks;
+        size_t used = block_size;
+    };
+
+    //--- private methods ---
+    static std::shared_ptr<const Mapping> mapFile(const std::string &filename);
+    uint32_t nextPriority();
+    NodePtr makeNode(const char *data, size_t length, size_t lfs, uint32_t priority,
+                     NodePtr left, NodePtr right) const;
+    NodePtr merge(const NodePtr &lhs, const NodePtr &rhs) const;
+    std::pair<NodePtr, NodePtr> split(const NodePtr &node, size_t pos) const;
+    NodePtr extendLast(const NodePtr &node, const char *end, size_t length, size_t lfs) const;
+    NodePtr buildPieces(const char *data, size_t length, const uint32_t *counts = nullptr);
+    void indexTail(size_t bytes, bool release, const uint32_t *counts = nullptr);
+    char *addBlock(size_t size);
+    void rewrite(const std::vector<Range> &ranges, const std::string &str);
+    bool walk(const NodePtr &node, size_t pos, size_t length, const SpanFunc &func) const;
+
+    //--- private properties ---
+    std::shared_ptr<Storage> _storage;
+    NodePtr _root;
+    const char *_tail;
+    size_t _tail_size;
+    uint32_t _seed;
+};
+
+// A part of a buffer as its own piece tree, it shares the pieces and their memory with the buffer it
+// came from. Spans keep erased text for undo without copying it.
+class TextBuffer::Span {
+public:
+    //--- public methods ---
+    size_t size() const;
+    size_t lines() const;
+    size_t memory() const;
+
+private:
+    //--- private properties ---
+    friend class TextBuffer;
+    NodePtr _root;
+};
@@ -16,306 +16,522 @@
  *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <clocale>
-#include <fstream>
-#include <iterator>
-#include <list>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <string>
-#include <ncurses.h>
+#include <vector>
+#include <unistd.h>
+#include "batch.hxx"
+#include "stats.hxx"
+#include "terminal.hxx"
+#include "workspace.hxx"
 
-// TODO: TAB key handling is really weird, so I ignore it for now
 // TODO: shifted keys are not ignored (and all printabled function keys)
 
 const std::string title = "Watte - weird and trivially tiny editor";
 const std::string version = "0.9.1";
 
-class Editor {
+const size_t max_batch = 1024 * 1024;
+
+// The terminal frontend: reads keys from the terminal, feeds them to the workspace and redraws the
+// rows the editor of the shown buffer reports as changed. Every frame is timed, F6 shows the
+// timings over the text and they are written to a file on quitting if one is given.
+class Screen {
 public:
     //--- public constructors ---
-    Editor(const char *filename)
-    : _data(), _filename(filename),
-#if DEBUG
-      _last_action(),
-#endif
-      _xpos(0), _ypos(1), _sline(0), _running(true)
+    Screen(Workspace &workspace, const std::string &dump)
+    : _workspace(workspace), _terminal(), _stats(), _dump(dump), _header(), _status(), _footer(),
+      _drawn_editor(nullptr), _drawn_sline(0), _drawn_srow(0), _drawn_lines(0), _drawn_rows(0),
+      _drawn_cols(0), _tokens(), _overlay(false), _drawn_overlay(false), _overlay_rows(0)
     {
-        std::setlocale(LC_ALL, "");
-        ::initscr();
-        ::start_color();
-        ::keypad(stdscr, true);
-        ::noecho();
-        ::cbreak();
-        ::raw();
-
-        ::init_pair(1, COLOR_WHITE, COLOR_BLUE);
-        ::init_pair(2, COLOR_WHITE, COLOR_BLUE);
-
-        if (loadFile())
-        {
-#if DEBUG
-            _last_action = "opened " + _filename;
-#endif
-        }
-        else
-        {
-            _data.push_back("");
-#if DEBUG
-            _last_action = "started new file " + _filename;
-#endif
-        }
-
+        _workspace.resize(_terminal.rows() - 2, _terminal.cols());
+        _workspace.editor().indexViewport();
         drawGUI();
-        ::refresh();
+        _terminal.flush();
     }
 
-    Editor(const Editor &rhs) = delete;
-    Editor(Editor &&rhs) = delete;
-
-    ~Editor() noexcept
-    {
-        ::endwin();
-    }
+    Screen(const Screen &rhs) = delete;
+    Screen(Screen &&rhs) = delete;
+    ~Screen() noexcept = default;
 
     //--- public operators ---
-    Editor &operator=(const Editor &rhs) = delete;
-    Editor &operator=(Editor &&rhs) = delete;
+    Screen &operator=(const Screen &rhs) = delete;
+    Screen &operator=(Screen &&rhs) = delete;
 
     //--- public methods ---
     int32_t run()
     {
-        while (_running)
+        std::vector<int32_t> keys;
+        Stats::Clock::time_point typed;
+        bool keyed = false;
+        int32_t timeout;
+        int32_t key;
+
+        while (_workspace.running())
         {
+            Editor &editor = _workspace.editor();
+            const size_t written = _terminal.written();
+            Stats::Clock::time_point start;
+            Stats::Clock::time_point end;
+
+            _workspace.finishJobs();
+            editor.finishSearch();
+            editor.indexViewport();
+            start = Stats::now();
             drawGUI();
-            ::refresh();
-            processInput(::getch());
+            end = Stats::now();
+            _stats.record(Stats::phase_draw, start, end);
+            start = end;
+            _terminal.flush();
+            end = Stats::now();
+            _stats.record(Stats::phase_flush, start, end);
+            _stats.count(Stats::counter_frames);
+            _stats.count(Stats::counter_output, _terminal.written() - written);
+            if (keyed)
+                _stats.record(Stats::phase_frame, typed, end);
+            keyed = false;
+
+            // while the file is not fully indexed, idle time goes into indexing the next part, or
+            // into taking the parts the index job counted since the last frame, a running load or
+            // save wakes the loop up regularly to show its progress, a running search shortly to
+            // show its first match and then regularly to show the match count
+            if (!editor.buffer().complete())
+                timeout = editor.indexJob().active() ? 10 : 0;
+            else if (editor.searching())
+                timeout = 10;
+            else if ((editor.job().type() != FileJob::Type::none)
+                     || (editor.finding() && !editor.searchJob().counted()))
+                timeout = 100;
+            else
+                timeout = -1;
+            key = _terminal.read(timeout);
+            if (key == Terminal::input_none)
+            {
+                editor.index();
+                continue;
+            }
+
+            // drain everything the terminal already sent and apply it before the next frame, an
+            // open paste is waited for a little, it usually arrives in several reads
+            typed = Stats::now();
+            keyed = true;
+            keys.clear();
+            do
+            {
+                if (key == Terminal::input_resize)
+                    _workspace.resize(_terminal.rows() - 2, _terminal.cols());
+                else if (key == (Terminal::input_f0 + 6))
+                    _overlay = !_overlay;
+                else if ((key = translate(key)) >= 0)
+                    keys.push_back(key);
+                timeout = (editor.paste() || (key == key_paste_begin)) ? 100 : 0;
+            }
+            while ((keys.size() < max_batch)
+                   && ((key = _terminal.read(timeout)) != Terminal::input_none));
+            start = Stats::now();
+            _stats.record(Stats::phase_input, typed, start);
+            _workspace.processKeys(keys);
+            _stats.record(Stats::phase_edit, start, Stats::now());
+            _stats.count(Stats::counter_keys, keys.size());
         }
 
-        return 0;
+        return (_dump.empty() || _stats.dump(_dump)) ? 0 : 1;
     }
 
     void drawGUI()
     {
-        const int32_t max_height = std::min(LINES - 2, static_cast<int32_t>(_data.size() - _sline));
-        std::string header = title + " (" + version + ") '" + _filename + "'";
-        std::string status = std::to_string(_data.size()) + " lines - "
-                             + std::to_string(_xpos) + "," + std::to_string(_ypos - 1 + _sline);
-        std::string footer = "(F1) reload file | (F2) save file | (F12) quit";
-        std::string buffer;
-
-        // header = title
-        header.resize(COLS - status.size(), ' ');
-        header += status;
-        ::attron(COLOR_PAIR(1));
-        mvaddnstr(0, 0, header.c_str(), header.size());
-        ::attroff(COLOR_PAIR(1));
-
-        // footer = status + buttons
-#if DEBUG
-        footer += " <> " + _last_action;
-#endif
-        footer.resize(COLS, ' ');
-        ::attron(COLOR_PAIR(2) | A_BOLD);
-        mvaddnstr(LINES - 1, 0, footer.c_str(), footer.size());
-        ::attroff(COLOR_PAIR(2) | A_BOLD);
-
-        // editor space
-        for (int32_t i = 0; i < max_height; ++i)
+        Editor &editor = _workspace.editor();
+        const TextBuffer &buffer = editor.buffer();
+        const int32_t rows = _terminal.rows() - 2;
+        const int32_t cols = _terminal.cols();
+        const size_t sline = editor.sline();
+        std::string status = std::to_string(buffer.lines()) + (buffer.complete() ? "" : "+")
+                             + " lines - " + std::to_string(editor.column()) + ","
+                             + std::to_string(editor.ypos() - 1 + sline);
+        std::string footer = std::string("(F1) reload file | (F2) save file | (^Z/^Y) undo/redo | "
+                                         "(^F/^R) find | (^T) replace | (^G) go to line | "
+                                         "(F5) wrap | ")
+                             + ((_workspace.count() > 1) ? "(F3/F4) buffers | (F12) close"
+                                                         : "(F12) quit");
+        std::string name = "'" + editor.filename() + "'";
+        std::string text;
+
+        if (_workspace.count() > 1)
+            name += " [" + std::to_string(_workspace.current() + 1) + "/"
+                    + std::to_string(_workspace.count()) + "]";
+
+        if (editor.finding() && !editor.regexMode() && !editor.query().empty())
+            status = std::to_string(editor.searchJob().count())
+                     + (editor.searchJob().counted() ? "" : "+") + " matches - " + status;
+        if (editor.jumping())
+            footer = "go to line: " + editor.jumpText()
+                     + " | (Enter) go | (^Home/^End) first/last line | (Esc) cancel";
+        else if (editor.replacing())
+            footer = "replace " + editor.query() + " with: " + editor.replacement()
+                     + " | (Enter) replace all | (Esc) cancel";
+        else if (editor.finding())
+            footer = (editor.regexMode() ? "regex: " : "find: ") + editor.query()
+                     + (editor.searching() ? " (searching)"
+                        : (editor.regexMode() && !editor.regex().valid() && !editor.query().empty())
+                          ? " (" + editor.regex().error() + ")"
+                        : (((editor.match() == SIZE_MAX) && !editor.query().empty())
+                           ? " (not found)" : ""))
+                     + " | (^F/^R) next | (^T) replace all | (Enter) done | (Esc) cancel";
+        else if (editor.job().type() != FileJob::Type::none)
+            footer = ((editor.job().type() == FileJob::Type::save) ? "saving " : "loading ")
+                     + std::to_string(editor.job().percent()) + "% | " + footer;
+        else if (!editor.notice().empty())
+            footer = editor.notice() + " | " + footer;
+
+        // another buffer is drawn anew, so is everything after a resize of the terminal
+        if (&editor != _drawn_editor)
         {
-            buffer = *std::next(_data.begin(), i + _sline);
-            buffer.resize(COLS, ' ');
-            mvaddnstr(i + 1, 0, buffer.c_str(), buffer.size());
+            _drawn_editor = &editor;
+            _drawn_sline = sline;
+            _status.clear();
+            editor.markLines(0, SIZE_MAX);
+        }
+        if (_overlay != _drawn_overlay)
+        {
+            _drawn_overlay = _overlay;
+            editor.markLines(0, SIZE_MAX);
+        }
+        if ((_terminal.rows() != _drawn_rows) || (cols != _drawn_cols))
+        {
+            _drawn_rows = _terminal.rows();
+            _drawn_cols = cols;
+            _status.clear();
+            _footer.clear();
+            editor.markLines(0, SIZE_MAX);
         }
 
-        ::move(_ypos, _xpos);
-    }
-
-    void processInput(const int32_t key) noexcept
-    {
-        const char chr = key;
-        int32_t lines_below = std::max(0, static_cast<int32_t>(_data.size()) - _sline);
-        int32_t max_height = std::min(LINES - 2, lines_below);
-        int32_t max_width = std::min(COLS, static_cast<int32_t>(std::next(_data.begin(),
-                                           _ypos + _sline - 1)->size()));
-        int32_t old_xpos = _xpos;
-        int32_t old_ypos = _ypos;
-
-        switch (key)
+        // header = title + status, only rebuilt when the status changed
+        if (status != _status)
         {
-            case KEY_F(1):
-                loadFile();
-#if DEBUG
-                _last_action = "reloaded " + _filename;
-#endif
-                break;
+            _status = status;
+            _header = title + " (" + version + ") " + name;
+            _header.resize(std::max<int32_t>(cols - status.size(), 0), ' ');
+            _header += status;
+            _terminal.put(0, 0, _header, Terminal::color_bar);
+        }
 
-            case KEY_F(2):
-                saveFile();
+        // footer = status + buttons, only rebuilt when the text changed
 #if DEBUG
-                _last_action = "saved " + _filename;
+        footer += " <> " + editor.lastAction();
 #endif
-                break;
+        footer.resize(cols, ' ');
+        if (footer != _footer)
+        {
+            _footer = footer;
+            _terminal.put(rows + 1, 0, _footer, Terminal::color_bar | Terminal::bold);
+        }
 
-            case KEY_F(12):
-                _running = false;
-                break;
+        // editor space, scrolling moves the rows still valid and only exposes the new ones, wrapped
+        // lines take a varying number of rows, so the view is drawn anew, so is a view that moved
+        // by more than it shows
+        const int64_t distance = static_cast<int64_t>(sline) - static_cast<int64_t>(_drawn_sline);
+        const int32_t scrolled = std::clamp<int64_t>(distance, -rows, rows);
 
-            case KEY_UP:
-                _ypos = std::max(_ypos - 1, 1);
-                if ((old_ypos == _ypos) && (_sline > 0))
-                    --_sline;
-                max_width = std::min(COLS, static_cast<int32_t>(std::next(_data.begin(),
-                                           _ypos + _sline - 1)->size()));
-                _xpos = std::min(_xpos, max_width);
-                break;
+        if (editor.wrapped() && (scrolled || (editor.srow() != _drawn_srow)))
+            editor.markLines(0, SIZE_MAX);
+        else if (scrolled && (std::abs(scrolled) < rows))
+        {
+            _terminal.scrollRows(1, rows, scrolled);
+            if (scrolled > 0)
+                editor.markLines(sline + rows - scrolled, sline + rows);
+            else
+                editor.markLines(sline, sline - scrolled);
+            if (_overlay)
+                editor.markLines(sline, sline + _overlay_rows - std::min(scrolled, 0));
+        }
+        else if (scrolled)
+            editor.markLines(0, SIZE_MAX);
 
-            case KEY_DOWN:
-                _ypos = std::min(_ypos + 1, max_height);
-                if ((old_ypos == _ypos) && ((lines_below - LINES + 2) > 0))
-                    ++_sline;
-                max_width = std::min(COLS, static_cast<int32_t>(std::next(_data.begin(),
-                                           _ypos + _sline - 1)->size()));
-                _xpos = std::min(_xpos, max_width);
-                break;
+        // rows below the last line keep old content when lines got removed
+        if (buffer.lines() != _drawn_lines)
+            editor.markLines(std::max<size_t>(std::min(buffer.lines(), _drawn_lines), 1) - 1,
+                              SIZE_MAX);
 
-            case KEY_LEFT:
-                _xpos = std::max(_xpos - 1, 0);
-                break;
+        // lexing the lines in view marks the ones looking different since they were drawn
+        editor.highlight(sline, sline + rows);
 
-            case KEY_RIGHT:
-                _xpos = std::min(_xpos + 1, max_width);
-                break;
+        const size_t first = std::max<size_t>(editor.dirtyFirst(), sline);
+        const size_t last = std::min<size_t>(editor.dirtyLast(), sline + rows);
 
-            case KEY_DC: // delete char = delete
-                if (_xpos < max_width)
-                    std::next(_data.begin(), _ypos + _sline - 1)->erase(_xpos, 1);
-                else if ((_ypos > 1) || (_sline > 0)) // line wrapping delete
-                {
-                    auto &next_line = *std::next(_data.begin(), _ypos + _sline);
+        // lines are drawn the way the layout of the columns in view shows them, wrapped lines take
+        // a row for every view width of them and the first line starts at the top row of the view
+        if (editor.wrapped())
+        {
+            int32_t row = 1;
 
-                    *std::next(_data.begin(), _ypos + _sline - 1) += next_line;
-                    _data.erase(std::next(_data.begin(), _ypos + _sline));
-                }
-                break;
+            for (size_t line = sline; (line < last) && (row <= rows); ++line)
+            {
+                const int32_t count = (line < buffer.lines()) ? editor.lineRows(line) : 1;
+                const int32_t skip = (line == static_cast<size_t>(sline)) ? editor.srow() : 0;
+                const int32_t top = row - skip;
 
-            case KEY_BACKSPACE:
-                if (_xpos > 0)
-                    std::next(_data.begin(), _ypos + _sline - 1)->erase(_xpos-- - 1, 1);
-                else if ((_ypos > 1) || (_sline > 0)) // line wrapping backspace
+                for (int32_t wrap = skip; (wrap < count) && (row <= rows); ++wrap, ++row)
                 {
-                    auto &prev_line = *std::next(_data.begin(), _ypos + _sline - 2);
-
-                    old_xpos = prev_line.size();
-                    prev_line += *std::next(_data.begin(), _ypos + _sline - 1);
-                    _data.erase(std::next(_data.begin(), _ypos + _sline - 1));
-
-                    _ypos = std::max(_ypos - 1, 1);
-                    if ((old_ypos == _ypos) && (_sline > 0))
-                        --_sline;
-                    max_width = std::min(COLS, static_cast<int32_t>(std::next(_data.begin(),
-                                               _ypos + _sline - 1)->size()));
-                    _xpos = std::min(old_xpos, max_width);
+                    if (line < first)
+                        continue;
+
+                    text.assign(cols, ' ');
+                    if (line < buffer.lines())
+                        text = editor.layout(line).render(wrap * cols, cols);
+                    _terminal.put(row, 0, text);
+                    _stats.count(Stats::counter_rows);
                 }
-                break;
+                if ((line >= first) && (line < buffer.lines()))
+                    paintTokens(editor, line, top);
+            }
+        }
+        else
+        {
+            for (size_t line = first; line < last; ++line)
+            {
+                text.assign(cols, ' ');
+                if (line < buffer.lines())
+                    text = editor.layout(line).render(editor.scol(), cols);
+                _terminal.put(line - sline + 1, 0, text);
+                _stats.count(Stats::counter_rows);
+                if (line < buffer.lines())
+                    paintTokens(editor, line, line - sline + 1);
+            }
+        }
 
-            case KEY_HOME:
-                _xpos = 0;
-                break;
+        // the current match is highlighted, the editor marks its line to be redrawn when it moves
+        if (editor.finding() && !editor.replacing() && (editor.match() != SIZE_MAX))
+        {
+            const size_t line = buffer.lineOf(editor.match());
+            const size_t offset = editor.match() - buffer.lineStart(line);
+            LineLayout &layout = editor.layout(line);
+            const int32_t column = layout.columnOf(offset);
+            const int32_t end = layout.columnOf(offset + editor.matchLength());
+
+            if ((line >= first) && (line < last))
+                paint(editor, editor.lineRow(line), column, std::max(end, column + 1),
+                      Terminal::reverse);
+        }
 
-            case KEY_END:
-                _xpos = max_width;
-                break;
+        // the statistics are shown over the right end of the top rows, the lines scrolled away from
+        // under them are drawn again
+        if (_overlay)
+        {
+            const std::vector<std::string> overlay = _stats.overlay();
 
-            case KEY_PPAGE: // prev page = uses half page scrolling
-                _ypos = std::max(_ypos - (LINES / 2), 1);
-                if ((old_ypos == _ypos) && (_sline > 0))
-                    _sline = std::max(_sline - (LINES / 2), 0);
-                max_width = std::min(COLS, static_cast<int32_t>(std::next(_data.begin(),
-                                           _ypos + _sline - 1)->size()));
-                _xpos = std::min(_xpos, max_width);
-                break;
+            _overlay_rows = std::min<int32_t>(overlay.size(), rows);
+            for (int32_t row = 0; row < _overlay_rows; ++row)
+                _terminal.put(row + 1, std::max<int32_t>(cols - overlay[row].size(), 0),
+                              overlay[row], Terminal::color_bar);
+        }
 
-            case KEY_NPAGE:
-                _ypos = std::min(_ypos + (LINES / 2), max_height);
-                if ((old_ypos == _ypos) && ((lines_below + LINES + 2) > 0))
-                    _sline = std::min(_sline + (LINES / 2), lines_below);
-                max_width = std::min(COLS, static_cast<int32_t>(std::next(_data.begin(),
-                                           _ypos + _sline - 1)->size()));
-                _xpos = std::min(_xpos, max_width);
-                break;
+        _drawn_sline = sline;
+        _drawn_srow = editor.srow();
+        _drawn_lines = buffer.lines();
+        editor.clearDirty();
 
-            case KEY_ENTER:
-            case 10:
-                if (_xpos == max_width)
-                    _data.insert(std::next(_data.begin(), _ypos + _sline), "");
-                else
-                {
-                    const std::string substr = std::next(_data.begin(),
-                                               _ypos + _sline - 1)->substr(_xpos);
+        _terminal.cursor(editor.cursorRow(), editor.cursorColumn());
+    }
 
-                    std::next(_data.begin(), _ypos + _sline - 1)->erase(_xpos);
-                    _data.insert(std::next(_data.begin(), _ypos + _sline), substr);
-                }
-                lines_below = std::max(0, static_cast<int32_t>(_data.size()) - _sline);
-                max_height = std::min(LINES - 2, lines_below);
-                _ypos = std::min(_ypos + 1, max_height);
-                if ((old_ypos == _ypos) && ((lines_below - LINES + 2) > 0))
-                    ++_sline;
-                _xpos = 0;
-                break;
+private:
+    //--- private methods ---
+    // changes the attributes of the columns of a line from column up to end, the line starts at row,
+    // which is above the view for a wrapped line shown from a later row on
+    void paint(Editor &editor, const int32_t row, const int32_t column, const int32_t end,
+               const Terminal::Look look)
+    {
+        const int32_t rows = _terminal.rows() - 2;
+        const int32_t cols = _terminal.cols();
 
-            default:
-                if (std::isprint(chr))
-                    std::next(_data.begin(), _ypos + _sline -1)->insert(_xpos++, 1, chr);
+        if (!editor.wrapped())
+        {
+            const int32_t from = std::max(column - editor.scol(), 0);
+            const int32_t to = std::min(end - editor.scol(), cols);
+
+            if (from < to)
+                _terminal.paint(row, from, to - from, look);
+            return;
+        }
+
+        for (int32_t at = column; at < end;)
+        {
+            const int32_t length = std::min(end - at, cols - (at % cols));
+
+            if (((row + (at / cols)) >= 1) && ((row + (at / cols)) <= rows))
+                _terminal.paint(row + (at / cols), at % cols, length, look);
+            at += length;
         }
     }
 
-    bool loadFile()
+    // colors the tokens of a line in the columns of its layout, tokens reaching out of them are cut
+    // at their edges, so only columns in view are looked up
+    void paintTokens(Editor &editor, const size_t line, const int32_t row)
     {
-        if (std::ifstream ifile(_filename); ifile.is_open() && ifile.good())
+        if (!editor.syntax().tokens(editor.buffer(), line, _tokens))
+            return;
+
+        LineLayout &layout = editor.layout(line);
+        const int32_t first = layout.first();
+        const int32_t rows = editor.wrapped() ? (_terminal.rows() - 2) : 1;
+        const int32_t last = first + (_terminal.cols() * rows);
+        const size_t begin = layout.offsetOf(first);
+        const size_t end = layout.offsetOf(last);
+
+        for (const Syntax::Token &token : _tokens)
         {
-            std::string line;
+            if (((token.offset + token.length) <= begin) || (token.offset > end))
+                continue;
 
-            _data.clear();
-            while (std::getline(ifile, line))
-                _data.insert(_data.end(), line);
-            ifile.close();
+            const int32_t column = (token.offset > begin) ? layout.columnOf(token.offset) : first;
+            const int32_t stop = ((token.offset + token.length) < end)
+                                 ? layout.columnOf(token.offset + token.length) : last;
+            const Terminal::Look look = (token.style == Syntax::Style::keyword) ? Terminal::bold : 0;
 
-            return true;
+            paint(editor, row, column, stop, look | static_cast<Terminal::Look>(token.style));
         }
-
-        return false;
     }
 
-    bool saveFile()
+    static int32_t translate(const int32_t key)
     {
-        if (std::ofstream ofile(_filename); ofile.is_open() && ofile.good())
+        switch (key)
         {
-            for (auto &line : _data)
-                ofile << line << '\n';
-            ofile.close();
-
-            return true;
+            case Terminal::input_up:
+                return key_up;
+            case Terminal::input_down:
+                return key_down;
+            case Terminal::input_left:
+                return key_left;
+            case Terminal::input_right:
+                return key_right;
+            case Terminal::input_home:
+                return key_home;
+            case Terminal::input_end:
+                return key_end;
+            case Terminal::input_page_up:
+                return key_page_up;
+            case Terminal::input_page_down:
+                return key_page_down;
+            case Terminal::input_backspace:
+                return key_backspace;
+            case Terminal::input_delete:
+                return key_delete;
+            case Terminal::input_ctrl_home:
+                return key_file_start;
+            case Terminal::input_ctrl_end:
+                return key_file_end;
+            case Terminal::input_f0 + 1:
+                return key_reload;
+            case Terminal::input_f0 + 2:
+                return key_save;
+            case Terminal::input_f0 + 3:
+                return key_previous_buffer;
+            case Terminal::input_f0 + 4:
+                return key_next_buffer;
+            case Terminal::input_f0 + 5:
+                return key_wrap;
+            case Terminal::input_f0 + 12:
+                return key_quit;
+            case 'z' & 0x1f:
+                return key_undo;
+            case 'y' & 0x1f:
+                return key_redo;
+            case 'f' & 0x1f:
+                return key_find;
+            case 'r' & 0x1f:
+                return key_find_regex;
+            case 't' & 0x1f:
+                return key_replace;
+            case 'g' & 0x1f:
+                return key_goto;
+            case 27:
+                return key_cancel;
+            case Terminal::input_paste_begin:
+                return key_paste_begin;
+            case Terminal::input_paste_end:
+                return key_paste_end;
+            default:
+                return ((key >= 0) && (key < 256)) ? key : -1;
         }
-
-        return false;
     }
 
-private:
     //--- private properties ---
-    std::list<std::string> _data;
-    std::string _filename;
-#if DEBUG
-    std::string _last_action;
-#endif
-    int32_t _xpos;
-    int32_t _ypos;
-    int32_t _sline;
-    bool _running;
+    Workspace &_workspace;
+    Terminal _terminal;
+    Stats _stats;
+    std::string _dump;
+    std::string _header;
+    std::string _status;
+    std::string _footer;
+    const Editor *_drawn_editor;
+    size_t _drawn_sline;
+    int32_t _drawn_srow;
+    size_t _drawn_lines;
+    int32_t _drawn_rows;
+    int32_t _drawn_cols;
+    std::vector<Syntax::Token> _tokens;
+    bool _overlay;
+    bool _drawn_overlay;
+    int32_t _overlay_rows;
 };
 
+static void usage(const char *name)
+{
+    std::fprintf(stderr, "usage: %s [-b script] [-s file] [-u megabytes] [file...]\n"
+                 "  -b  apply the key and command script to the files without a terminal, - reads\n"
+                 "      the script from stdin\n"
+                 "  -s  write the frame timings and counters to file when quitting, F6 shows them\n"
+                 "  -u  memory limit of the undo history (default %zu)\n", name,
+                 History::default_limit / (1024 * 1024));
+}
+
 int32_t main(int32_t argc, char **argv)
 {
-    Editor ed((argc == 2) ? argv[1] : "noname.txt");
+    const char *script = nullptr;
+    const char *stats = "";
+    size_t undo_limit = History::default_limit;
+    int32_t opt;
+
+    // widths of characters come from the locale, batch mode moves the cursor over the same ones
+    std::setlocale(LC_ALL, "");
+    while ((opt = ::getopt(argc, argv, "b:s:u:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'b':
+                script = optarg;
+                break;
+
+            case 's':
+                stats = optarg;
+                break;
+
+            case 'u':
+                undo_limit = std::strtoull(optarg, nullptr, 10) * 1024 * 1024;
+                break;
+
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+
+    Workspace workspace(batch_rows, batch_cols);
+
+    // every file is a buffer of its own, the first one is shown
+    workspace.setUndoLimit(undo_limit);
+    if (optind == argc)
+        workspace.open("noname.txt");
+    for (; optind < argc; ++optind)
+        workspace.open(argv[optind]);
+    workspace.switchTo(0);
+
+    if (script)
+        return runBatch(workspace, script);
+
+    Screen screen(workspace, stats);
 
-    return ed.run();
+    return screen.run();
 }
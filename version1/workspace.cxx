@@ -0,0 +1,138 @@
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+
+#include <algorithm>
+#include "workspace.hxx"
+
+//--- public constructors ---
+
+Workspace::Workspace(const int32_t rows, const int32_t cols)
+: _editors(), _current(0), _undo_limit(History::default_limit), _rows(rows), _cols(cols)
+{
+}
+
+//--- public methods ---
+
+void Workspace::open(const std::string &filename)
+{
+    // a file open in another buffer already is mapped only once, both buffers share its content
+    _editors.push_back(std::make_unique<Editor>(filename, _rows, _cols));
+    _editors.back()->setUndoLimit(_undo_limit);
+    switchTo(_editors.size() - 1);
+}
+
+void Workspace::switchTo(const size_t index)
+{
+    if ((index >= _editors.size()) || (index == _current))
+        return;
+
+    if (_current < _editors.size())
+        _editors[_current]->compact();
+    _current = index;
+    _editors[_current]->indexViewport();
+    _editors[_current]->markLines(0, SIZE_MAX);
+}
+
+void Workspace::resize(const int32_t rows, const int32_t cols)
+{
+    _rows = rows;
+    _cols = cols;
+    for (auto &editor : _editors)
+        editor->resize(rows, cols);
+}
+
+void Workspace::processKeys(const std::vector<int32_t> &keys)
+{
+    auto begin = keys.begin();
+
+    // the keys up to a buffer switch go to the buffer shown until then, the keys behind a quit of
+    // that buffer are dropped with it
+    while (running() && (begin != keys.end()))
+    {
+        const auto end = std::find_if(begin, keys.end(), [](const int32_t key) {
+            return (key == key_next_buffer) || (key == key_previous_buffer);
+        });
+
+        if (begin != end)
+            _editors[_current]->processKeys(std::vector<int32_t>(begin, end));
+        if (!_editors[_current]->running())
+            close();
+        else if (end == keys.end())
+            break;
+        else if (*end == key_next_buffer)
+            switchTo((_current + 1) % _editors.size());
+        else
+            switchTo((_current + _editors.size() - 1) % _editors.size());
+        begin = (end == keys.end()) ? end : (end + 1);
+    }
+}
+
+void Workspace::finishJobs()
+{
+    // saves of buffers put aside finish as well
+    for (auto &editor : _editors)
+        editor->finishJob();
+}
+
+void Workspace::setUndoLimit(const size_t bytes)
+{
+    _undo_limit = bytes;
+    for (auto &editor : _editors)
+        editor->setUndoLimit(bytes);
+}
+
+Editor &Workspace::editor()
+{
+    return *_editors[_current];
+}
+
+const Editor &Workspace::editor() const
+{
+    return *_editors[_current];
+}
+
+size_t Workspace::current() const
+{
+    return _current;
+}
+
+size_t Workspace::count() const
+{
+    return _editors.size();
+}
+
+bool Workspace::running() const
+{
+    return !_editors.empty();
+}
+
+//--- private methods ---
+
+void Workspace::close()
+{
+    // the buffer in front of the closed one is shown next
+    _editors.erase(_editors.begin() + _current);
+    if (_current)
+        --_current;
+    if (_current < _editors.size())
+    {
+        _editors[_current]->indexViewport();
+        _editors[_current]->markLines(0, SIZE_MAX);
+    }
+}
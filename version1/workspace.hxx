@@ -0,0 +1,66 @@
+#pragma once
+/*
+ *  Watte - weird and trivially tiny editor
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "editor.hxx"
+
+// All open buffers, each one with its own editor, one of them is shown and gets the keys. Switching
+// keeps the cursor, the view and the history of every buffer. A buffer put aside is compacted, it
+// gives back the mapped pages of its file and the caches of its searches. Quitting closes the shown
+// buffer, the workspace runs as long as a buffer is left.
+class Workspace {
+public:
+    //--- public constructors ---
+    Workspace(const int32_t rows, const int32_t cols);
+    Workspace(const Workspace &rhs) = delete;
+    Workspace(Workspace &&rhs) = delete;
+    ~Workspace() noexcept = default;
+
+    //--- public operators ---
+    Workspace &operator=(const Workspace &rhs) = delete;
+    Workspace &operator=(Workspace &&rhs) = delete;
+
+    //--- public methods ---
+    void open(const std::string &filename);
+    void switchTo(const size_t index);
+    void resize(const int32_t rows, const int32_t cols);
+    void processKeys(const std::vector<int32_t> &keys);
+    void finishJobs();
+    void setUndoLimit(const size_t bytes);
+
+    Editor &editor();
+    const Editor &editor() const;
+    size_t current() const;
+    size_t count() const;
+    bool running() const;
+
+private:
+    //--- private methods ---
+    void close();
+
+    //--- private properties ---
+    std::vector<std::unique_ptr<Editor>> _editors;
+    size_t _current;
+    size_t _undo_limit;
+    int32_t _rows;
+    int32_t _cols;
+};
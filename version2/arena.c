@@ -0,0 +1,198 @@
+/*
+ *  Watte 2 - weird and trivially tiny editor (C version)
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+#include "support.h"
+
+#define ARENA_ALIGN 16
+
+/* steps of about 1.5 keep the waste per allocation at a third at most */
+static const ssize_t arena_classes[ARENA_CLASSES] = {
+	16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096, 6144, 8192
+};
+
+struct arena_large_t {
+	struct arena_large_t *prev;
+	struct arena_large_t *next;
+};
+
+static ssize_t _class(const ssize_t size)
+{
+	for (ssize_t i = 0; i < ARENA_CLASSES; ++i)
+		if (size <= arena_classes[i])
+			return i;
+
+	return -ENOMEM;
+}
+
+static void *_alloc_large(struct arena_t *arena, const ssize_t size)
+{
+	struct arena_large_t *large = malloc(sizeof (struct arena_large_t) + size);
+
+	if (!large)
+		return NULL;
+
+	large->prev = NULL;
+	large->next = arena->large;
+	if (arena->large)
+		arena->large->prev = large;
+	arena->large = large;
+
+	return large + 1;
+}
+
+static void _free_large(struct arena_t *arena, void *ptr)
+{
+	struct arena_large_t *large = (struct arena_large_t *)ptr - 1;
+
+	if (large->prev)
+		large->prev->next = large->next;
+	else
+		arena->large = large->next;
+	if (large->next)
+		large->next->prev = large->prev;
+
+	free(large);
+}
+
+ssize_t arena_init(struct arena_t *arena)
+{
+	if (!arena)
+		return -EFAULT;
+
+	_zero(arena, sizeof (struct arena_t));
+	arena->used = ARENA_CHUNK_SIZE;
+
+	return 0;
+}
+
+ssize_t arena_size(const ssize_t size)
+{
+	const ssize_t index = _class(size);
+
+	return (index < 0) ? size : arena_classes[index];
+}
+
+void *arena_alloc(struct arena_t *arena, const ssize_t size)
+{
+	if (!arena || (size <= 0))
+		return NULL;
+
+	const ssize_t index = _class(size);
+	void *ptr;
+
+	if (index < 0)
+		return _alloc_large(arena, size);
+
+	/* freed memory of the same class is reused first */
+	ptr = arena->free[index];
+	if (ptr) {
+		arena->free[index] = *(void **)ptr;
+		return ptr;
+	}
+
+	/* chunks are linked through their first bytes, the rest of a full chunk is left unused */
+	if ((arena->used + arena_classes[index]) > ARENA_CHUNK_SIZE) {
+		char *chunk = malloc(ARENA_CHUNK_SIZE);
+
+		if (!chunk)
+			return NULL;
+
+		*(char **)chunk = arena->chunk;
+		arena->chunk = chunk;
+		arena->used = ARENA_ALIGN;
+	}
+
+	ptr = arena->chunk + arena->used;
+	arena->used += arena_classes[index];
+
+	return ptr;
+}
+
+void *arena_realloc(struct arena_t *arena, void *ptr, const ssize_t old_size, const ssize_t size)
+{
+	if (!arena || (size <= 0))
+		return NULL;
+
+	if (!ptr)
+		return arena_alloc(arena, size);
+
+	const ssize_t index = _class(size);
+	void *tmp;
+
+	if ((index >= 0) && (index == _class(old_size)))
+		return ptr;
+
+	tmp = arena_alloc(arena, size);
+	if (!tmp)
+		return NULL;
+
+	memcpy(tmp, ptr, _min(old_size, size));
+	arena_free(arena, ptr, old_size);
+
+	return tmp;
+}
+
+ssize_t arena_free(struct arena_t *arena, void *ptr, const ssize_t size)
+{
+	if (!arena || !ptr)
+		return -EFAULT;
+
+	const ssize_t index = _class(size);
+
+	if (index < 0) {
+		_free_large(arena, ptr);
+		return 0;
+	}
+
+	*(void **)ptr = arena->free[index];
+	arena->free[index] = ptr;
+
+	return 0;
+}
+
+ssize_t arena_destroy(struct arena_t *arena)
+{
+	if (!arena)
+		return -EFAULT;
+
+	ssize_t count = 0;
+	struct arena_large_t *large;
+	char *chunk;
+
+	while (arena->chunk) {
+		chunk = arena->chunk;
+		arena->chunk = *(char **)chunk;
+		free(chunk);
+		++count;
+	}
+
+	while (arena->large) {
+		large = arena->large;
+		arena->large = large->next;
+		free(large);
+		++count;
+	}
+
+	arena_init(arena);
+
+	return count;
+}
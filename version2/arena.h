@@ -0,0 +1,45 @@
+#pragma once
+/*
+ *  Watte 2 - weird and trivially tiny editor (C version)
+ *  Copyright (C) 2020 Wilken 'Akiko' Gottwalt <akiko@linux-addicted.net>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <sys/types.h>
+
+#define ARENA_CHUNK_SIZE (1024 * 1024)
+#define ARENA_CLASSES 18
+
+struct arena_large_t;
+
+/*
+ * Memory for many small objects with the same lifetime, like the lines of a file. Allocations are
+ * rounded up to a size class and carved out of large chunks, freed ones are kept in per class free
+ * lists for reuse. Allocations above the largest class come from malloc(), but still belong to the
+ * arena. arena_destroy() releases everything at once, without touching single allocations.
+ */
+struct arena_t {
+	char *chunk;
+	ssize_t used;
+	struct arena_large_t *large;
+	void *free[ARENA_CLASSES];
+};
+
+ssize_t arena_init(struct arena_t *arena);
+ssize_t arena_size(const ssize_t size);
+void *arena_alloc(struct arena_t *arena, const ssize_t size);
+void *arena_realloc(struct arena_t *arena, void *ptr, const ssize_t old_size, const ssize_t size);
+ssize_t arena_free(struct arena_t *arena, void *ptr, const ssize_t size);
+ssize_t arena_destroy(struct arena_t *arena);
@@ -18,41 +18,43 @@
 
 #include <errno.h>
 #include <stdlib.h>
+#include <string.h>
+#include "arena.h"
 #include "string.h"
 #include "support.h"
 
+static ssize_t _reserve(struct string_t *str, const ssize_t capacity)
+{
+	char *tmp;
+
+	/* arena memory comes in size classes, the whole class is usable */
+	if (str->arena) {
+		tmp = arena_realloc(str->arena, str->data, str->capacity, capacity);
+		if (!tmp)
+			return -ENOMEM;
+		str->capacity = arena_size(capacity);
+	} else {
+		tmp = (char *)realloc(str->data, capacity);
+		if (!tmp)
+			return -ENOMEM;
+		str->capacity = capacity;
+	}
+	str->data = tmp;
+
+	return str->capacity;
+}
+
 ssize_t string_init(struct string_t *str)
 {
 	if (!str)
 		return -EFAULT;
 
-	if (str->data) {
-		if (str->capacity != STRING_DEF_SIZE) {
-			char *tmp = (char *)realloc(str->data, STRING_DEF_SIZE);
-
-			if (!tmp)
-				goto string_init_fail;
-			else
-				str->data = tmp;
-		}
-	} else {
-		str->data = (char *)malloc(STRING_DEF_SIZE);
-		if (!str->data)
-			goto string_init_fail;
+	if (_reserve(str, STRING_DEF_SIZE) < 0) {
+		string_destroy(str);
+		return -ENOMEM;
 	}
-	str->length = 0;
-	str->capacity = STRING_DEF_SIZE;
 
 	return string_clear(str);
-
-string_init_fail:
-	if (str->data)
-		free(str->data);
-	str->length = 0;
-	str->capacity = 0;
-	str->data = NULL;
-
-	return -ENOMEM;
 }
 
 ssize_t string_init_cstr(struct string_t *str, const char *src)
@@ -65,30 +67,24 @@ ssize_t string_init_cstr(struct string_t *str, const char *src)
 	if (size < 0)
 		return size;
 
-	if (str->data) {
-		char *tmp = (char *)realloc(str->data, size + 1);
-
-		if (!tmp)
-			return -ENOMEM;
+	return string_init_data(str, src, size);
+}
 
-		str->length = size;
-		str->capacity = size + 1;
-		str->data = tmp;
-	} else {
-		str->data = (char *)malloc(size + 1);
+ssize_t string_init_data(struct string_t *str, const char *src, const ssize_t size)
+{
+	if (!str || (!src && size))
+		return -EFAULT;
 
-		if (!str->data) {
-			str->length = 0;
-			str->capacity = 0;
+	if ((size < 0) || (size > STRING_MAX_SIZE))
+		return -ENOMEM;
 
-			return -ENOMEM;
-		}
-	}
+	if (_reserve(str, size + 1) < 0)
+		return -ENOMEM;
 
-	for (ssize_t i = 0; i < size; ++i)
-		str->data[i] = src[i];
-	for (ssize_t i = str->length; i < str->capacity; ++i)
-		str->data[i] = 0;
+	str->length = size;
+	if (size)
+		memcpy(str->data, src, size);
+	str->data[size] = 0;
 
 	return size;
 }
@@ -98,33 +94,7 @@ ssize_t string_init_string(struct string_t *str, const struct string_t *src)
 	if (!str || !src)
 		return -EFAULT;
 
-	const ssize_t capacity = _max(src->capacity, STRING_DEF_SIZE);
-
-	if (str->data) {
-		char *tmp = (char *)realloc(str->data, capacity);
-
-		if (!tmp)
-			return -ENOMEM;
-
-		str->length = capacity - 1;
-		str->capacity = capacity;
-		str->data = tmp;
-	} else {
-		str->data = (char *)malloc(capacity);
-		if (!str->data) {
-			str->length = 0;
-			str->capacity = 0;
-
-			return -ENOMEM;
-		}
-	}
-
-	for (ssize_t i = 0; i < (capacity - 1); ++i)
-		str->data[i] = src->data[i];
-	for (ssize_t i = str->length; i < str->capacity; ++i)
-		str->data[i] = 0;
-
-	return capacity - 1;
+	return string_init_data(str, src->data, src->length);
 }
 
 ssize_t string_clear(struct string_t *str)
@@ -132,16 +102,12 @@ ssize_t string_clear(struct string_t *str)
 	if (!str)
 		return -EFAULT;
 
-	ssize_t count = 0;
-
-	if (str->data) {
-		count = _zero(str->data, str->capacity);
-		if (count < 0)
-			str->capacity = 0;
-		str->length = 0;
-	}
+	/* only the terminator is reset, the rest of the capacity is never read */
+	if (str->data)
+		str->data[0] = 0;
+	str->length = 0;
 
-	return count;
+	return 0;
 }
 
 ssize_t string_copy(struct string_t *dest, const struct string_t *src)
@@ -149,22 +115,12 @@ ssize_t string_copy(struct string_t *dest, const struct string_t *src)
 	if (!dest || !src)
 		return -EFAULT;
 
-	if ((dest->capacity + 1) <= src->length) {
-		char *tmp = (char *)realloc(dest->data, src->length + 1);
-
-		if (!tmp)
-			return -ENOMEM;
-
-		dest->data = tmp;
-		dest->capacity = src->length + 1;
-	}
+	if ((dest->capacity <= src->length) && (_reserve(dest, src->length + 1) < 0))
+		return -ENOMEM;
 
 	dest->length = src->length;
-
-	for (ssize_t i = 0; i < src->length; ++i)
-		dest->data[i] = src->data[i];
-	for (ssize_t i = dest->length; i < dest->capacity; ++i)
-		dest->data[i] = 0;
+	memcpy(dest->data, src->data, src->length);
+	dest->data[dest->length] = 0;
 
 	return dest->length;
 }
@@ -174,22 +130,14 @@ ssize_t string_concat(struct string_t *dest, const struct string_t *src)
 	if (!dest || !src)
 		return -EFAULT;
 
-	ssize_t size = dest->length + src->length + 1;
-
-	if ((dest->capacity + 1) <= size) {
-		char *tmp = (char *)realloc(dest->data, size);
+	const ssize_t size = dest->length + src->length + 1;
 
-		if (!tmp)
-			return -ENOMEM;
-
-		dest->data = tmp;
-		dest->capacity = size;
-	}
+	if ((dest->capacity < size) && (_reserve(dest, size) < 0))
+		return -ENOMEM;
 
+	memcpy(dest->data + dest->length, src->data, src->length);
 	dest->length = size - 1;
-
-	for (ssize_t i = 0; i < src->length; ++i)
-		dest->data[i + dest->length] = src->data[i];
+	dest->data[dest->length] = 0;
 
 	return dest->length;
 }
@@ -200,7 +148,10 @@ ssize_t string_destroy(struct string_t *str)
 		return -EFAULT;
 
 	if (str->data) {
-		free(str->data);
+		if (str->arena)
+			arena_free(str->arena, str->data, str->capacity);
+		else
+			free(str->data);
 		str->data = NULL;
 	}
 	str->length = 0;
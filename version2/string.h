@@ -20,16 +20,21 @@
 #include <sys/types.h>
 
 #define STRING_MAX_SIZE 4096
-#define STRING_DEF_SIZE 128
+#define STRING_DEF_SIZE 16
 
+struct arena_t;
+
+/* strings with an arena take their memory from it, all others use malloc() */
 struct string_t {
 	ssize_t length;
 	ssize_t capacity;
 	char *data;
+	struct arena_t *arena;
 };
 
 ssize_t string_init(struct string_t *str);
 ssize_t string_init_cstr(struct string_t *str, const char *src);
+ssize_t string_init_data(struct string_t *str, const char *src, const ssize_t size);
 ssize_t string_init_string(struct string_t *str, const struct string_t *src);
 ssize_t string_clear(struct string_t *str);
 ssize_t string_copy(struct string_t *dest, const struct string_t *src);
@@ -18,10 +18,49 @@
 
 #include <errno.h>
 #include <stdlib.h>
+#include "arena.h"
 #include "string.h"
 #include "stringlist.h"
 #include "support.h"
 
+static void _free_entry(struct stringlist_t *list)
+{
+	struct arena_t *arena = list->string.arena;
+
+	string_destroy(&list->string);
+	if (arena)
+		arena_free(arena, list, sizeof (struct stringlist_t));
+	else
+		free(list);
+}
+
+ssize_t stringlist_create(struct stringlist_t **list, struct arena_t *arena)
+{
+	if (!list)
+		return -EFAULT;
+
+	struct stringlist_t *current;
+	ssize_t count;
+
+	if (arena)
+		current = (struct stringlist_t *)arena_alloc(arena, sizeof (struct stringlist_t));
+	else
+		current = (struct stringlist_t *)malloc(sizeof (struct stringlist_t));
+	if (!current)
+		return -ENOMEM;
+
+	_zero(current, sizeof (struct stringlist_t));
+	current->string.arena = arena;
+	count = string_init(&current->string);
+	if (count < 0) {
+		_free_entry(current);
+		return count;
+	}
+	*list = current;
+
+	return 1;
+}
+
 ssize_t stringlist_length(struct stringlist_t *list)
 {
 	if (!list)
@@ -70,27 +109,27 @@ ssize_t stringlist_add_entry(struct stringlist_t *list, const bool before)
 	if (!list)
 		return -EFAULT;
 
-	struct stringlist_t *current = (struct stringlist_t *)malloc(sizeof (struct stringlist_t));
-	ssize_t count;
+	struct stringlist_t *current = NULL;
+	ssize_t count = stringlist_create(&current, list->string.arena);
 
-	if (!current)
-		return -ENOMEM;
+	if (count < 0)
+		return count;
 
 	if (before) {
 		current->prev = list->prev;
 		current->next = list;
+		if (list->prev)
+			list->prev->next = current;
+		list->prev = current;
 	} else {
 		current->prev = list;
 		current->next = list->next;
-	}
-	count = string_init(&current->string);
-
-	if (count) {
-		list = current;
-		return 1;
+		if (list->next)
+			list->next->prev = current;
+		list->next = current;
 	}
 
-	return count;
+	return 1;
 }
 
 ssize_t stringlist_add_entry_before(struct stringlist_t *list)
@@ -106,13 +145,15 @@ ssize_t stringlist_add_entry_after(struct stringlist_t *list)
 ssize_t stringlist_add_entry_from(struct stringlist_t *list, const char *src, const bool before)
 {
 	ssize_t err = stringlist_add_entry(list, before);
+	struct stringlist_t *current;
 
 	if (err < 0)
 		return err;
 
-	err = string_init_cstr(&list->string, src);
+	current = before ? list->prev : list->next;
+	err = string_init_cstr(&current->string, src);
 	if (err < 0)
-		stringlist_del_entry(list);
+		stringlist_del_entry(current);
 
 	return err;
 }
@@ -132,36 +173,32 @@ ssize_t stringlist_del_entry(struct stringlist_t *list)
 	if (!list)
 		return -EFAULT;
 
-	struct stringlist_t *current = NULL;
+	if (list->prev)
+		list->prev->next = list->next;
+	if (list->next)
+		list->next->prev = list->prev;
 
-	string_destroy(&list->string);
-
-	if (list->prev) {
-		current = list->prev;
-		current->next = list->next;
-	} else if (list->next) {
-		current = list->next;
-		current->next = list->next->next;
-	}
-
-	free(list);
-	list = current;
+	_free_entry(list);
 
 	return 1;
 }
 
+/* lists living in an arena are released faster by destroying the arena */
 ssize_t stringlist_destroy(struct stringlist_t *list)
 {
 	if (!list)
 		return -EFAULT;
 
 	ssize_t count = 0;
-	struct stringlist_t *current = list;
+	struct stringlist_t *next;
 
-	stringlist_first(current);
+	while (list->prev)
+		list = list->prev;
 
-	while (current) {
-		stringlist_del_entry(current);
+	while (list) {
+		next = list->next;
+		stringlist_del_entry(list);
+		list = next;
 		++count;
 	}
 
@@ -20,12 +20,18 @@
 #include <stdbool.h>
 #include <sys/types.h>
 
+struct arena_t;
+
+/* entries created with an arena take their memory from it, new neighbours use the same arena,
+   a line longer than a string is kept in several entries and all but its last one continue it */
 struct stringlist_t {
 	struct string_t string;
 	struct stringlist_t *prev;
 	struct stringlist_t *next;
+	bool continued;
 };
 
+ssize_t stringlist_create(struct stringlist_t **list, struct arena_t *arena);
 ssize_t stringlist_length(struct stringlist_t *list);
 ssize_t stringlist_first(struct stringlist_t *list);
 ssize_t stringlist_last(struct stringlist_t *list);
@@ -16,16 +16,30 @@
  *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#define _DEFAULT_SOURCE /* mkstemp, fchmod, fchown, realpath */
+
 #include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 #include <unistd.h>
+#include "arena.h"
+#include "linescan.h"
 #include "string.h"
 #include "stringlist.h"
 #include "support.h"
 
+#define LOAD_BATCH 4096
+#define SAVE_BATCH 512
+
 struct editor {
+	struct arena_t arena;
 	struct stringlist_t *data;
 	struct string_t filename;
 	int32_t xpos;
@@ -34,37 +48,250 @@ struct editor {
 	bool running;
 };
 
+ssize_t editor_append_line(struct stringlist_t **tail, struct arena_t *arena, const char *src,
+			   const ssize_t size)
+{
+	ssize_t offset = 0;
+	ssize_t err;
+
+	/* long lines go into chunks of the largest string size, an edit only moves its own chunk */
+	do {
+		const ssize_t chunk = _min(size - offset, STRING_MAX_SIZE);
+
+		if (*tail) {
+			err = stringlist_add_entry_after(*tail);
+			if (err < 0)
+				return err;
+			*tail = (*tail)->next;
+		} else {
+			err = stringlist_create(tail, arena);
+			if (err < 0)
+				return err;
+		}
+
+		err = string_init_data(&(*tail)->string, src + offset, chunk);
+		if (err < 0)
+			return err;
+		offset += chunk;
+		(*tail)->continued = offset < size;
+	} while (offset < size);
+
+	return size;
+}
+
+ssize_t editor_load(const char *filename, struct arena_t *arena, struct stringlist_t **data)
+{
+	struct stringlist_t *head = NULL;
+	struct stringlist_t *tail = NULL;
+	struct stat st;
+	size_t starts[LOAD_BATCH];
+	const char *content;
+	size_t offset = 0;
+	size_t line = 0;
+	ssize_t lines = 0;
+	ssize_t count = 0;
+	ssize_t err = 0;
+	int fd;
+
+	if (!filename || !data)
+		return -EFAULT;
+
+	fd = open(filename, O_RDONLY);
+	if (fd < 0)
+		return -ENOENT;
+
+	if ((fstat(fd, &st) < 0) || !S_ISREG(st.st_mode)) {
+		close(fd);
+		return -EIO;
+	}
+
+	const size_t size = st.st_size;
+
+	content = size ? mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0) : "";
+	close(fd);
+	if (content == MAP_FAILED)
+		return -EIO;
+
+	/* line starts are collected in batches, the last line feed of the file is implied */
+	while (offset < size) {
+		err = linescan_starts(content + offset, size - offset, starts, LOAD_BATCH);
+		if (err <= 0)
+			break;
+
+		for (ssize_t i = 0; i < err; ++i) {
+			const size_t next = offset + starts[i];
+
+			count = editor_append_line(&tail, arena, content + line, next - line - 1);
+			if (count < 0)
+				goto editor_load_fail;
+			if (!head)
+				head = tail;
+			line = next;
+			++lines;
+		}
+		offset += starts[err - 1];
+	}
+
+	if ((line < size) || !tail) {
+		count = editor_append_line(&tail, arena, content + line, size - line);
+		if (count < 0)
+			goto editor_load_fail;
+		if (!head)
+			head = tail;
+		++lines;
+	}
+
+	if (size)
+		munmap((void *)content, size);
+	*data = head;
+
+	return lines;
+
+editor_load_fail:
+	if (size)
+		munmap((void *)content, size);
+	if (tail)
+		stringlist_destroy(tail);
+
+	return count;
+}
+
+ssize_t editor_write(int fd, struct iovec *iov, int count)
+{
+	ssize_t written;
+
+	while (count > 0) {
+		written = writev(fd, iov, count);
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			return -EIO;
+		}
+
+		/* partial writes continue with the first entry not completely written */
+		while (count && ((size_t)written >= iov->iov_len)) {
+			written -= iov->iov_len;
+			++iov;
+			--count;
+		}
+		if (count) {
+			iov->iov_base = (char *)iov->iov_base + written;
+			iov->iov_len -= written;
+		}
+	}
+
+	return 0;
+}
+
 ssize_t editor_save(const char *filename, struct stringlist_t *data)
 {
-	FILE *fd = NULL;
+	struct iovec iov[SAVE_BATCH * 2];
+	char resolved[PATH_MAX];
+	char tmpname[PATH_MAX];
+	char dirname[PATH_MAX];
+	const char *target;
+	const char *slash;
+	struct stat st;
 	ssize_t count = 0;
 	ssize_t err = 0;
+	int entries = 0;
+	int fd;
 
 	if (!filename)
 		return -ENOENT;
 
-	fd = fopen(filename, "w");
-	if (!fd)
+	/* a symlink stays one, the file it points to is replaced */
+	target = realpath(filename, resolved) ? resolved : filename;
+
+	/* everything goes into a temporary file next to the target, it replaces it when complete */
+	slash = strrchr(target, '/');
+	if (slash) {
+		err = snprintf(tmpname, sizeof (tmpname), "%.*s.%s.XXXXXX", (int)(slash - target + 1),
+			       target, slash + 1);
+		snprintf(dirname, sizeof (dirname), "%.*s", (int)(slash - target + 1), target);
+	} else {
+		err = snprintf(tmpname, sizeof (tmpname), ".%s.XXXXXX", target);
+		strcpy(dirname, ".");
+	}
+	if ((err < 0) || ((size_t)err >= sizeof (tmpname)))
+		return -ENAMETOOLONG;
+
+	fd = mkstemp(tmpname);
+	if (fd < 0)
 		return -EIO;
 
-	err = stringlist_first(data);
-	if (err < 0)
+	/* the new file takes over the permissions of the old one, a new one gets the usual ones,
+	   nothing else runs here, so the umask can be read by setting it */
+	if (!stat(target, &st)) {
+		fchmod(fd, st.st_mode & 07777);
+		if (fchown(fd, st.st_uid, st.st_gid) < 0)
+			fchmod(fd, st.st_mode & 0777);
+	} else {
+		const mode_t mask = umask(0);
+
+		umask(mask);
+		fchmod(fd, 0666 & ~mask);
+	}
+
+	while (data && data->prev)
+		data = data->prev;
+
+	/* every line is its text and a line feed, both gathered into writev() batches, the chunks of a
+	   long line only get the line feed behind the last one */
+	for (err = 0; data && !err; data = data->next) {
+		iov[entries].iov_base = data->string.data;
+		iov[entries].iov_len = data->string.length;
+		++entries;
+		if (!data->continued) {
+			iov[entries].iov_base = "\n";
+			iov[entries].iov_len = 1;
+			++entries;
+			++count;
+		}
+
+		if (entries >= ((SAVE_BATCH * 2) - 1)) {
+			err = editor_write(fd, iov, entries);
+			entries = 0;
+		}
+	}
+	if (!err)
+		err = editor_write(fd, iov, entries);
+	if (!err && fsync(fd))
+		err = -EIO;
+	if (close(fd) && !err)
+		err = -EIO;
+	if (!err && rename(tmpname, target))
+		err = -EIO;
+
+	if (err) {
+		unlink(tmpname);
 		return err;
+	}
 
-	while (data) {
-		err = fwrite(data->string.data, data->string.length, 1, fd);
-		if (err == 0)
-			return -EIO;
-		count += err;
-		data = data->next;
+	/* make the rename itself durable */
+	fd = open(dirname, O_RDONLY | O_DIRECTORY);
+	if (fd >= 0) {
+		fsync(fd);
+		close(fd);
 	}
 
 	return count;
 }
 
-ssize_t editor_run(struct editor *ed, const char *filename)
+ssize_t editor_run(struct editor *ed, const char *filename, const char *savename)
 {
-	string_init_from(&ed->filename, filename);
+	ssize_t lines;
+	ssize_t err = 0;
+
+	string_init_cstr(&ed->filename, filename);
+	arena_init(&ed->arena);
+
+	lines = editor_load(ed->filename.data, &ed->arena, &ed->data);
+	if (lines < 0) {
+		lines = stringlist_create(&ed->data, &ed->arena);
+		if (lines < 0)
+			return lines;
+	}
 
 	while (ed->running)
 	{
@@ -79,20 +306,28 @@ ssize_t editor_run(struct editor *ed, const char *filename)
 		ed->running = false;
 	}
 
+	/* there is nothing to edit on yet, the loaded buffer can only be saved as another file */
+	if (savename)
+		err = editor_save(savename, ed->data);
+
+	/* all lines live in the arena, they go away with it */
+	arena_destroy(&ed->arena);
+	ed->data = NULL;
 	string_destroy(&ed->filename);
 
-	return 0;
+	return (err < 0) ? err : 0;
 }
 
 /*--- main ---*/
 
 int32_t main(int32_t argc, char **argv)
 {
+	const char *filename = (argc >= 2) ? argv[1] : "noname.txt";
 	struct editor ed;
 
 	_zero(&ed, sizeof (ed));
 
-	if (editor_run(&ed, (argc == 2) ? argv[1] : "noname.txt") >= 0)
+	if (editor_run(&ed, filename, (argc == 3) ? argv[2] : NULL) >= 0)
 		return 0;
 
 	return 1;